@@ -39,13 +39,27 @@ static mpc_instance_t  *mpc_ins;
 
 
 static void mpc_rlimit_reset();
+static int mpc_init_sweep(mpc_instance_t *ins);
 static void mpc_instance_init(mpc_instance_t *ins);
 static void mpc_instance_merge(mpc_instance_t *ins, mpc_instance_t *tmp_ins);
 static char *mpc_conf_log_level(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
 static char *mpc_conf_address(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
 static char *mpc_conf_http_method(mpc_conf_t *cf, mpc_command_t *cmd,
     void *conf);
+static char *mpc_conf_output_format(mpc_conf_t *cf, mpc_command_t *cmd,
+    void *conf);
 static char *mpc_conf_run_time(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
+static char *mpc_conf_interval(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
+static char *mpc_conf_warmup(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
+static char *mpc_conf_slo(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
+static char *mpc_conf_sweep_target(mpc_conf_t *cf, mpc_command_t *cmd,
+    void *conf);
+static void mpc_conf_join_args(mpc_conf_t *cf, uint8_t *buf, size_t size);
+static char *mpc_conf_sweep_step(mpc_conf_t *cf, mpc_command_t *cmd,
+    void *conf);
+static int mpc_add_slo(mpc_instance_t *ins, char *text);
+static char *mpc_conf_source(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
+static int mpc_add_source(mpc_instance_t *ins, char *text);
 
 
 static mpc_command_t  mpc_conf_commands[] = {
@@ -78,6 +92,20 @@ static mpc_command_t  mpc_conf_commands[] = {
       offsetof(mpc_instance_t, replay),
       NULL },
 
+    { mpc_string("precise_time"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, precise_time),
+      NULL },
+
+    { mpc_string("keepalive"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, keepalive),
+      NULL },
+
     { mpc_string("url_file"),
       MPC_CONF_TAKE1,
       mpc_conf_set_str_slot,
@@ -85,6 +113,13 @@ static mpc_command_t  mpc_conf_commands[] = {
       offsetof(mpc_instance_t, url_file),
       NULL },
 
+    { mpc_string("unix_socket"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_str_slot,
+      0,
+      offsetof(mpc_instance_t, unix_socket),
+      NULL },
+
     { mpc_string("address"),
       MPC_CONF_TAKE1,
       mpc_conf_address,
@@ -92,6 +127,13 @@ static mpc_command_t  mpc_conf_commands[] = {
       0,
       NULL },
 
+    { mpc_string("prefer_ipv6"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, prefer_ipv6),
+      NULL },
+
     { mpc_string("concurrency"),
       MPC_CONF_TAKE1,
       mpc_conf_set_num_slot,
@@ -99,6 +141,125 @@ static mpc_command_t  mpc_conf_commands[] = {
       offsetof(mpc_instance_t, concurrency),
       NULL },
 
+    { mpc_string("reset_close"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, reset_close),
+      NULL },
+
+    { mpc_string("server_close"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, server_close),
+      NULL },
+
+    { mpc_string("pipeline"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_num_slot,
+      0,
+      offsetof(mpc_instance_t, pipeline),
+      NULL },
+
+    { mpc_string("source"),
+      MPC_CONF_TAKE1,
+      mpc_conf_source,
+      0,
+      0,
+      NULL },
+
+    { mpc_string("host_concurrency"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_num_slot,
+      0,
+      offsetof(mpc_instance_t, host_concurrency),
+      NULL },
+
+    { mpc_string("host_idle"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_num_slot,
+      0,
+      offsetof(mpc_instance_t, host_idle),
+      NULL },
+
+    { mpc_string("tcp_nodelay"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, tcp_nodelay),
+      NULL },
+
+    { mpc_string("tcp_quickack"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, tcp_quickack),
+      NULL },
+
+    { mpc_string("rcvbuf"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_size_slot,
+      0,
+      offsetof(mpc_instance_t, rcvbuf),
+      NULL },
+
+    { mpc_string("sndbuf"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_size_slot,
+      0,
+      offsetof(mpc_instance_t, sndbuf),
+      NULL },
+
+    { mpc_string("tcp_user_timeout"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_msec_slot,
+      0,
+      offsetof(mpc_instance_t, tcp_user_timeout),
+      NULL },
+
+    { mpc_string("tcp_congestion"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_str_slot,
+      0,
+      offsetof(mpc_instance_t, tcp_congestion),
+      NULL },
+
+    { mpc_string("fastopen"),
+      MPC_CONF_FLAG,
+      mpc_conf_set_flag_slot,
+      0,
+      offsetof(mpc_instance_t, fastopen),
+      NULL },
+
+    { mpc_string("event_batch"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_num_slot,
+      0,
+      offsetof(mpc_instance_t, event_batch),
+      NULL },
+
+    { mpc_string("connect_timeout"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_msec_slot,
+      0,
+      offsetof(mpc_instance_t, connect_timeout),
+      NULL },
+
+    { mpc_string("read_timeout"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_msec_slot,
+      0,
+      offsetof(mpc_instance_t, read_timeout),
+      NULL },
+
+    { mpc_string("timeout"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_msec_slot,
+      0,
+      offsetof(mpc_instance_t, timeout),
+      NULL },
+
     { mpc_string("http_method"),
       MPC_CONF_TAKE1,
       mpc_conf_http_method,
@@ -113,6 +274,13 @@ static mpc_command_t  mpc_conf_commands[] = {
       offsetof(mpc_instance_t, result_file),
       NULL },
 
+    { mpc_string("output_format"),
+      MPC_CONF_TAKE1,
+      mpc_conf_output_format,
+      0,
+      0,
+      NULL },
+
     { mpc_string("result_mark"),
       MPC_CONF_TAKE1,
       mpc_conf_set_str_slot,
@@ -127,6 +295,76 @@ static mpc_command_t  mpc_conf_commands[] = {
       0,
       NULL },
 
+    { mpc_string("interval"),
+      MPC_CONF_TAKE1,
+      mpc_conf_interval,
+      0,
+      0,
+      NULL },
+
+    { mpc_string("warmup"),
+      MPC_CONF_TAKE1,
+      mpc_conf_warmup,
+      0,
+      0,
+      NULL },
+
+    { mpc_string("warmup_requests"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_num_slot,
+      0,
+      offsetof(mpc_instance_t, warmup_requests),
+      NULL },
+
+    { mpc_string("series_file"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_str_slot,
+      0,
+      offsetof(mpc_instance_t, series_file),
+      NULL },
+
+    { mpc_string("success_codes"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_str_slot,
+      0,
+      offsetof(mpc_instance_t, success_codes),
+      NULL },
+
+    { mpc_string("slo"),
+      MPC_CONF_1MORE,
+      mpc_conf_slo,
+      0,
+      0,
+      NULL },
+
+    { mpc_string("slo_tolerance"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_num_slot,
+      0,
+      offsetof(mpc_instance_t, slo_tolerance),
+      NULL },
+
+    { mpc_string("sweep_concurrency"),
+      MPC_CONF_TAKE1,
+      mpc_conf_set_str_slot,
+      0,
+      offsetof(mpc_instance_t, sweep_concurrency),
+      NULL },
+
+    { mpc_string("sweep_step"),
+      MPC_CONF_TAKE1,
+      mpc_conf_sweep_step,
+      0,
+      0,
+      NULL },
+
+    { mpc_string("sweep_target"),
+      MPC_CONF_1MORE,
+      mpc_conf_sweep_target,
+      0,
+      0,
+      NULL },
+
       mpc_null_command
 };
 
@@ -136,28 +374,52 @@ static struct option  long_options[] = {
     { "version",         no_argument,        NULL,   'v' },
     { "follow-location", no_argument,        NULL,   'f' },
     { "replay",          no_argument,        NULL,   'r' },
+    { "precise-time",    no_argument,        NULL,   'p' },
+    { "keepalive",       no_argument,        NULL,   'k' },
+    { "reset-close",     no_argument,        NULL,   'z' },
+    { "server-close",    no_argument,        NULL,   'Z' },
+    { "fastopen",        no_argument,        NULL,   'F' },
+    { "pipeline",        required_argument,  NULL,   'P' },
+    { "host-concurrency", required_argument, NULL,   'H' },
+    { "host-idle",       required_argument,  NULL,   'I' },
+    { "source",          required_argument,  NULL,   'b' },
+    { "connect-timeout", required_argument,  NULL,   'n' },
+    { "read-timeout",    required_argument,  NULL,   'e' },
+    { "timeout",         required_argument,  NULL,   'd' },
     { "log-file",        required_argument,  NULL,   'l' },
     { "log-level",       required_argument,  NULL,   'L' },
     { "conf",            required_argument,  NULL,   'C' },
     { "url-file",        required_argument,  NULL,   'u' },
     { "address",         required_argument,  NULL,   'a' },
+    { "unix-socket",     required_argument,  NULL,   'U' },
+    { "prefer-ipv6",     no_argument,        NULL,   '6' },
     { "concurrency",     required_argument,  NULL,   'c' },
     { "method",          required_argument,  NULL,   'm' },
     { "result-file",     required_argument,  NULL,   'R' },
     { "result-mark",     required_argument,  NULL,   'M' },
+    { "output-format",   required_argument,  NULL,   'o' },
     { "run-time",        required_argument,  NULL,   't' },
+    { "interval",        required_argument,  NULL,   'i' },
+    { "series-file",     required_argument,  NULL,   's' },
+    { "warmup",          required_argument,  NULL,   'w' },
+    { "warmup-requests", required_argument,  NULL,   'W' },
+    { "success-codes",   required_argument,  NULL,   'S' },
+    { "slo",             required_argument,  NULL,   'O' },
+    { "slo-tolerance",   required_argument,  NULL,   'T' },
+    { "sweep-concurrency", required_argument, NULL,  'x' },
+    { "sweep-step",      required_argument,  NULL,   'X' },
+    { "sweep-target",    required_argument,  NULL,   'G' },
     { NULL,              0,                  NULL,    0  }
 };
 
 
-static char *short_options = "hvfrl:L:C:u:a:c:m:R:M:t:";
+static char *short_options = "hvfrpkzZF6l:L:C:u:a:U:c:P:H:I:b:n:e:d:m:R:M:o:t:i:s:S:w:W:O:T:x:X:G:";
 
 
 static int
 mpc_get_options(int argc, char **argv, mpc_instance_t *ins)
 {
     int              c;
-    struct hostent  *he;
     mpc_str_t        t;
 
     opterr = 0;
@@ -183,6 +445,30 @@ mpc_get_options(int argc, char **argv, mpc_instance_t *ins)
             ins->replay = 1;
             break;
 
+        case 'p':
+            ins->precise_time = 1;
+            break;
+
+        case 'k':
+            ins->keepalive = 1;
+            break;
+
+        case 'z':
+            ins->reset_close = 1;
+            break;
+
+        case 'Z':
+            ins->server_close = 1;
+            break;
+
+        case 'F':
+            ins->fastopen = 1;
+            break;
+
+        case '6':
+            ins->prefer_ipv6 = 1;
+            break;
+
         case 'C':
             if (ins->conf_file.len != 0) {
                 mpc_log_stderr(0, "duplicate option '-C'");
@@ -219,18 +505,19 @@ mpc_get_options(int argc, char **argv, mpc_instance_t *ins)
             break;
 
         case 'a':
-            if (inet_aton(optarg, &ins->addr.sin_addr) == 0) {
-                if ((he = gethostbyname(optarg)) == NULL) {
-                    mpc_log_stderr(0, "option '-a' host \"%s\" not found",
-                                   optarg);
-                    return MPC_ERROR;
-                }
-                mpc_memcpy(&ins->addr.sin_addr, he->h_addr, 
-                           sizeof(struct in_addr));
+            if (mpc_net_resolve(&ins->addr, optarg) != MPC_OK) {
+                mpc_log_stderr(0, "option '-a' host \"%s\" not found",
+                               optarg);
+                return MPC_ERROR;
             }
             ins->use_addr = 1;
             break;
 
+        case 'U':
+            ins->unix_socket.data = (uint8_t *) optarg;
+            ins->unix_socket.len = mpc_strlen(optarg);
+            break;
+
         case 'c':
             ins->concurrency = mpc_atoi((uint8_t *)optarg, strlen(optarg));
             if (ins->concurrency == MPC_ERROR) {
@@ -247,6 +534,82 @@ mpc_get_options(int argc, char **argv, mpc_instance_t *ins)
             }
             break;
 
+        case 'P':
+            ins->pipeline = mpc_atoi((uint8_t *)optarg, strlen(optarg));
+            if (ins->pipeline == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-P' requires a number");
+                return MPC_ERROR;
+            }
+
+            if (ins->pipeline < 1 || ins->pipeline > MPC_MAX_PIPELINE) {
+                mpc_log_stderr(0, "option '-P' value must be between 1 and %ud",
+                               MPC_MAX_PIPELINE); 
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'H':
+            ins->host_concurrency = mpc_atoi((uint8_t *)optarg,
+                                             strlen(optarg));
+            if (ins->host_concurrency == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-H' requires a number");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'I':
+            ins->host_idle = mpc_atoi((uint8_t *)optarg, strlen(optarg));
+            if (ins->host_idle == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-I' requires a number");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'n':
+            t.data = (uint8_t *) optarg;
+            t.len = mpc_strlen(optarg);
+
+            ins->connect_timeout = mpc_parse_time(&t, 0);
+            if (ins->connect_timeout == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-n' requires a valid time" CRLF
+                                  "such as: 500ms");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'e':
+            t.data = (uint8_t *) optarg;
+            t.len = mpc_strlen(optarg);
+
+            ins->read_timeout = mpc_parse_time(&t, 0);
+            if (ins->read_timeout == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-e' requires a valid time" CRLF
+                                  "such as: 5s");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'd':
+            t.data = (uint8_t *) optarg;
+            t.len = mpc_strlen(optarg);
+
+            ins->timeout = mpc_parse_time(&t, 0);
+            if (ins->timeout == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-d' requires a valid time" CRLF
+                                  "such as: 10s");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'b':
+            if (mpc_add_source(ins, optarg) != MPC_OK) {
+                mpc_log_stderr(0, "option '-b' requires a source address" CRLF
+                                  "such as: \"10.0.0.1\" or "
+                                  "\"10.0.0.1:20000-29999\"");
+                return MPC_ERROR;
+            }
+            break;
+
         case 'm':
             ins->http_method = mpc_http_get_method(optarg);
             if (ins->http_method == MPC_ERROR) {
@@ -274,16 +637,127 @@ mpc_get_options(int argc, char **argv, mpc_instance_t *ins)
             ins->result_mark.len = mpc_strlen(optarg);
             break;
 
+        case 'o':
+            ins->output_format = mpc_stat_get_format(optarg);
+            if (ins->output_format == MPC_ERROR) {
+                mpc_log_stderr(0, 
+                          "option '-o' requires a valid format: text|csv|json");
+                return MPC_ERROR;
+            }
+            break;
+
         case 't':
             t.data = (uint8_t *) optarg;
             t.len = mpc_strlen(optarg);
 
-            ins->run_time = mpc_parse_time(&t, 1);
-            if (ins->run_time == MPC_ERROR) {
-                mpc_log_stderr(0, "option '-t' requires a valid time" CRLF
-                                  "such as: 2d2h2m2s");
+            ins->run_time = mpc_parse_time(&t, 1);
+            if (ins->run_time == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-t' requires a valid time" CRLF
+                                  "such as: 2d2h2m2s");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'i':
+            t.data = (uint8_t *) optarg;
+            t.len = mpc_strlen(optarg);
+
+            ins->interval = mpc_parse_time(&t, 1);
+            if (ins->interval == MPC_ERROR || ins->interval == 0) {
+                mpc_log_stderr(0, "option '-i' requires a valid time" CRLF
+                                  "such as: 1m30s");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'w':
+            t.data = (uint8_t *) optarg;
+            t.len = mpc_strlen(optarg);
+
+            ins->warmup = mpc_parse_time(&t, 1);
+            if (ins->warmup == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-w' requires a valid time" CRLF
+                                  "such as: 30s");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'W':
+            ins->warmup_requests = mpc_atoi((uint8_t *)optarg, strlen(optarg));
+            if (ins->warmup_requests == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-W' requires a number");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 's':
+            if (ins->series_file.len != 0) {
+                mpc_log_stderr(0, "duplicate option '-s'");
+                return MPC_ERROR;
+            }
+            ins->series_file.data = (unsigned char *)optarg;
+            ins->series_file.len = mpc_strlen(optarg);
+            break;
+
+        case 'S':
+            if (ins->success_codes.len != 0) {
+                mpc_log_stderr(0, "duplicate option '-S'");
+                return MPC_ERROR;
+            }
+            ins->success_codes.data = (unsigned char *)optarg;
+            ins->success_codes.len = mpc_strlen(optarg);
+            break;
+
+        case 'O':
+            if (mpc_add_slo(ins, optarg) != MPC_OK) {
+                mpc_log_stderr(0, "option '-O' requires an objective" CRLF
+                                  "such as: \"p99 < 50ms\"");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'T':
+            ins->slo_tolerance = mpc_atoi((uint8_t *)optarg, strlen(optarg));
+            if (ins->slo_tolerance == MPC_ERROR) {
+                mpc_log_stderr(0, "option '-T' requires a number");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'x':
+            if (ins->sweep_concurrency.len != 0) {
+                mpc_log_stderr(0, "duplicate option '-x'");
+                return MPC_ERROR;
+            }
+            ins->sweep_concurrency.data = (unsigned char *)optarg;
+            ins->sweep_concurrency.len = mpc_strlen(optarg);
+            break;
+
+        case 'X':
+            t.data = (uint8_t *) optarg;
+            t.len = mpc_strlen(optarg);
+
+            ins->sweep_step = mpc_parse_time(&t, 1);
+            if (ins->sweep_step == MPC_ERROR || ins->sweep_step == 0) {
+                mpc_log_stderr(0, "option '-X' requires a valid time" CRLF
+                                  "such as: 10s");
+                return MPC_ERROR;
+            }
+            break;
+
+        case 'G':
+            if (ins->sweep_target_set) {
+                mpc_log_stderr(0, "duplicate option '-G'");
+                return MPC_ERROR;
+            }
+
+            if (mpc_stat_slo_parse(&ins->sweep_target, optarg) != MPC_OK) {
+                mpc_log_stderr(0, "option '-G' requires an objective" CRLF
+                                  "such as: \"p99 < 50ms\"");
                 return MPC_ERROR;
             }
+
+            ins->sweep_target_set = 1;
             break;
 
         default:
@@ -299,28 +773,111 @@ mpc_get_options(int argc, char **argv, mpc_instance_t *ins)
 static void
 mpc_show_usage(void)
 {
-    printf("Usage: mpc [-hvfr] [-l log file] [-L log level] " CRLF
-           "           [-c concurrency] [-u url file] [-m http method]" CRLF
+    printf("Usage: mpc [-hvfrpkzZF6] [-l log file] [-L log level] " CRLF
+           "           [-c concurrency] [-P pipeline] [-u url file]" CRLF
+           "           [-H host concurrency] [-I host idle] [-b source]" CRLF
+           "           [-n connect timeout] [-e read timeout] [-d timeout]"
+           CRLF
+           "           [-m http method]" CRLF
            "           [-R result file] [-M result mark string] " CRLF
-           "           [-a specified address] [-t run time]" CRLF
+           "           [-o output format]" CRLF
+           "           [-a specified address] [-6] [-U unix socket]" CRLF
+           "           [-t run time]" CRLF
+           "           [-i interval] [-s series file]" CRLF
+           "           [-S success codes] [-w warmup] [-W warmup requests]"
+           CRLF
+           "           [-O objective] [-T objective tolerance]" CRLF
+           "           [-x sweep concurrency] [-X sweep step] [-G sweep target]"
+           CRLF
            CRLF
            "Options:" CRLF
            "  -h, --help            : this help" CRLF
            "  -v, --version         : show version and exit" CRLF
            "  -C, --conf=S          : configuration file" CRLF
            "  -u, --url-file        : url file" CRLF
-           "  -a, --address=S       : use address specified instead of DNS" CRLF
+           "  -a, --address=S       : use address specified instead of DNS,"
+           CRLF
+           "                          IPv4 or IPv6" CRLF
+           "  -6, --prefer-ipv6     : resolve hosts to IPv6 addresses first"
+           CRLF
+           "  -U, --unix-socket=S   : connect to a unix domain socket"
+           CRLF
+           "                          instead of the hosts of urls" CRLF
            "  -f, --follow-location : follow 302 redirect" CRLF
            "  -r, --replay          : replay the url file" CRLF
+           "  -p, --precise-time    : read the clock for every timing sample"
+           CRLF
+           "  -k, --keepalive       : reuse connections with HTTP/1.1"
+           CRLF
+           "  -z, --reset-close     : close connections with RST, leaving"
+           CRLF
+           "                          no TIME_WAIT" CRLF
+           "  -Z, --server-close    : let the server close first after"
+           CRLF
+           "                          \"Connection: close\"" CRLF
+           "  -F, --fastopen        : send the request in the SYN with TCP"
+           CRLF
+           "                          Fast Open" CRLF
            "  -l, --log-file=S      : log file" CRLF
            "  -L, --log-level=S     : log level" CRLF
            "  -c, --concurrency=N   : concurrency" CRLF
+           "  -P, --pipeline=N      : requests in flight per connection,"
+           CRLF
+           "                          implies -k" CRLF
+           "  -H, --host-concurrency=N : connections in use per host:port"
+           CRLF
+           "  -I, --host-idle=N     : idle connections kept per host:port"
+           CRLF
+           "  -b, --source=S        : local address to connect from, with"
+           CRLF
+           "                          a port range \"10.0.0.1:20000-29999\","
+           CRLF
+           "                          or \"[::1]:20000-29999\", may be"
+           CRLF
+           "                          repeated" CRLF
+           "  -n, --connect-timeout=Nms : connect timeout, default 10s,"
+           CRLF
+           "                          0 for none" CRLF
+           "  -e, --read-timeout=Nms : timeout between two reads of a"
+           CRLF
+           "                          response, default 30s" CRLF
+           "  -d, --timeout=Nms     : timeout of a whole request, none by"
+           CRLF
+           "                          default" CRLF
            "  -m, --http-method=S   : http method GET, HEAD" CRLF
            "  -R, --result-file=S   : show result in a file" CRLF
            "  -M, --result-mark=S   : result file mark string" CRLF
+           "  -o, --output-format=S : result and series file format" CRLF
+           "                          text(default), csv, json" CRLF
            "  -t, --run-time=Nm     : timed testing where \"m\" is modifer" CRLF
            "                          S(second), M(minute), H(hour), D(day)"
            CRLF
+           "  -i, --interval=Nm     : report every interval while running" CRLF
+           "  -s, --series-file=S   : write interval reports in a file" CRLF
+           "  -w, --warmup=Nm       : exclude the first Nm of the run" CRLF
+           "  -W, --warmup-requests=N : exclude the first N requests" CRLF
+           "  -S, --success-codes=S : status codes counted as success" CRLF
+           "                          default: 200,302,404, 2xx for a class"
+           CRLF
+           "  -O, --slo=S           : objective checked every second, such as"
+           CRLF
+           "                          \"p99 < 50ms\", \"error_rate < 0.1%%\","
+           CRLF
+           "                          \"rps > 20000\", may be repeated" CRLF
+           "  -T, --slo-tolerance=N : seconds an objective may be missed"
+           CRLF
+           "                          before the run fails (exit code 2)"
+           CRLF
+           "  -x, --sweep-concurrency=S : step the concurrency over a"
+           CRLF
+           "                          schedule \"50,100,200\" or search"
+           CRLF
+           "                          a range \"10-1000\"" CRLF
+           "  -X, --sweep-step=Nm   : time a sweep step lasts, default 10s"
+           CRLF
+           "  -G, --sweep-target=S  : objective a sweep step must meet, such as"
+           CRLF
+           "                          \"p99 < 50ms\"" CRLF
            CRLF);
 }
 
@@ -353,7 +910,6 @@ mpc_conf_address(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
 {
     mpc_instance_t  *ins = (mpc_instance_t *)conf;
     mpc_str_t       *value;
-    struct hostent  *he;
 
     if (ins->use_addr) {
         return "duplicate \"address\"";
@@ -361,14 +917,10 @@ mpc_conf_address(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
 
     value = cf->args->elem;
 
-    if (inet_aton((char *)value[1].data, &ins->addr.sin_addr) == 0) {
-        if ((he = gethostbyname((char *)value[1].data)) == NULL) {
-            mpc_conf_log_error(MPC_LOG_EMERG, cf, h_errno,
-                               "invalid addr \"%s\"", value[1].data);
-            return MPC_CONF_ERROR;
-        }
-
-        mpc_memcpy(&ins->addr.sin_addr, he->h_addr, sizeof(struct in_addr));
+    if (mpc_net_resolve(&ins->addr, (char *)value[1].data) != MPC_OK) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid addr \"%s\"", value[1].data);
+        return MPC_CONF_ERROR;
     }
 
     ins->use_addr = 1;
@@ -400,6 +952,29 @@ mpc_conf_http_method(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
 }
 
 
+static char *
+mpc_conf_output_format(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
+{
+    mpc_instance_t  *ins = (mpc_instance_t *)conf;
+    mpc_str_t       *value;
+
+    if (ins->output_format != MPC_CONF_UNSET) {
+        return "duplicate \"output_format\"";
+    }
+
+    value = cf->args->elem;
+
+    ins->output_format = mpc_stat_get_format((char *)value[1].data);
+    if (ins->output_format == MPC_ERROR) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid output format \"%s\"", value[1].data);
+        return MPC_CONF_ERROR;
+    }
+
+    return MPC_CONF_OK;
+}
+
+
 static char *
 mpc_conf_run_time(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
 {
@@ -423,28 +998,320 @@ mpc_conf_run_time(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
 }
 
 
+static char *
+mpc_conf_interval(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
+{
+    mpc_instance_t  *ins = (mpc_instance_t *)conf;
+    mpc_str_t       *value;
+
+    if (ins->interval != MPC_CONF_UNSET_UINT) {
+        return "duplicate \"interval\"";
+    }
+
+    value = cf->args->elem;
+
+    ins->interval = mpc_parse_time(&value[1], 1);
+    if (ins->interval == MPC_ERROR || ins->interval == 0) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid interval \"%V\"", &value[1]);
+        return MPC_CONF_ERROR;
+    }
+
+    return MPC_CONF_OK;
+}
+
+
+static char *
+mpc_conf_warmup(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
+{
+    mpc_instance_t  *ins = (mpc_instance_t *)conf;
+    mpc_str_t       *value;
+
+    if (ins->warmup != MPC_CONF_UNSET_UINT) {
+        return "duplicate \"warmup\"";
+    }
+
+    value = cf->args->elem;
+
+    ins->warmup = mpc_parse_time(&value[1], 1);
+    if (ins->warmup == MPC_ERROR) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid warmup \"%V\"", &value[1]);
+        return MPC_CONF_ERROR;
+    }
+
+    return MPC_CONF_OK;
+}
+
+
+static char *
+mpc_conf_slo(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
+{
+    mpc_instance_t  *ins = (mpc_instance_t *)conf;
+    uint8_t          buf[MPC_STAT_SLO_TEXT_SIZE];
+
+    mpc_conf_join_args(cf, buf, sizeof(buf));
+
+    if (mpc_add_slo(ins, (char *)buf) != MPC_OK) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid objective \"%s\"", buf);
+        return MPC_CONF_ERROR;
+    }
+
+    return MPC_CONF_OK;
+}
+
+
+static char *
+mpc_conf_sweep_target(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
+{
+    mpc_instance_t  *ins = (mpc_instance_t *)conf;
+    uint8_t          buf[MPC_STAT_SLO_TEXT_SIZE];
+
+    if (ins->sweep_target_set) {
+        return "duplicate \"sweep_target\"";
+    }
+
+    mpc_conf_join_args(cf, buf, sizeof(buf));
+
+    if (mpc_stat_slo_parse(&ins->sweep_target, (char *)buf) != MPC_OK) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid sweep target \"%s\"", buf);
+        return MPC_CONF_ERROR;
+    }
+
+    ins->sweep_target_set = 1;
+
+    return MPC_CONF_OK;
+}
+
+
+/* "slo p99 < 50ms;" comes in three arguments, put them back together */
+static void
+mpc_conf_join_args(mpc_conf_t *cf, uint8_t *buf, size_t size)
+{
+    mpc_str_t  *value;
+    uint32_t    i;
+    uint8_t    *p, *last;
+
+    value = cf->args->elem;
+
+    p = buf;
+    last = buf + size - 1;
+
+    for (i = 1; i < cf->args->nelem; i++) {
+        p = mpc_slprintf(p, last, i == 1 ? "%V" : " %V", &value[i]);
+    }
+
+    *p = '\0';
+}
+
+
+static char *
+mpc_conf_sweep_step(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
+{
+    mpc_instance_t  *ins = (mpc_instance_t *)conf;
+    mpc_str_t       *value;
+
+    if (ins->sweep_step != MPC_CONF_UNSET_UINT) {
+        return "duplicate \"sweep_step\"";
+    }
+
+    value = cf->args->elem;
+
+    ins->sweep_step = mpc_parse_time(&value[1], 1);
+    if (ins->sweep_step == MPC_ERROR || ins->sweep_step == 0) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid sweep step \"%V\"", &value[1]);
+        return MPC_CONF_ERROR;
+    }
+
+    return MPC_CONF_OK;
+}
+
+
+static int
+mpc_add_slo(mpc_instance_t *ins, char *text)
+{
+    mpc_stat_slo_t  *slo;
+
+    if (ins->slos == NULL) {
+        ins->slos = mpc_array_create(4, sizeof(mpc_stat_slo_t));
+        if (ins->slos == NULL) {
+            return MPC_ERROR;
+        }
+    }
+
+    slo = mpc_array_push(ins->slos);
+    if (slo == NULL) {
+        return MPC_ERROR;
+    }
+
+    if (mpc_stat_slo_parse(slo, text) != MPC_OK) {
+        mpc_array_pop(ins->slos);
+        return MPC_ERROR;
+    }
+
+    return MPC_OK;
+}
+
+
+static char *
+mpc_conf_source(mpc_conf_t *cf, mpc_command_t *cmd, void *conf)
+{
+    mpc_instance_t  *ins = (mpc_instance_t *)conf;
+    mpc_str_t       *value;
+
+    value = cf->args->elem;
+
+    if (mpc_add_source(ins, (char *)value[1].data) != MPC_OK) {
+        mpc_conf_log_error(MPC_LOG_EMERG, cf, 0,
+                           "invalid source \"%V\"", &value[1]);
+        return MPC_CONF_ERROR;
+    }
+
+    return MPC_CONF_OK;
+}
+
+
+static int
+mpc_add_source(mpc_instance_t *ins, char *text)
+{
+    mpc_net_source_t  *source;
+
+    if (ins->sources == NULL) {
+        ins->sources = mpc_array_create(4, sizeof(mpc_net_source_t));
+        if (ins->sources == NULL) {
+            return MPC_ERROR;
+        }
+    }
+
+    source = mpc_array_push(ins->sources);
+    if (source == NULL) {
+        return MPC_ERROR;
+    }
+
+    if (mpc_net_parse_source(source, text) != MPC_OK) {
+        mpc_array_pop(ins->sources);
+        return MPC_ERROR;
+    }
+
+    return MPC_OK;
+}
+
+
 static void
 mpc_instance_merge(mpc_instance_t *ins, mpc_instance_t *tmp_ins)
 {
     mpc_conf_merge_str_value(ins->url_file, tmp_ins->url_file, "");
     mpc_conf_merge_str_value(ins->result_file, tmp_ins->result_file, "");
     mpc_conf_merge_str_value(ins->result_mark, tmp_ins->result_mark, "");
+    mpc_conf_merge_str_value(ins->series_file, tmp_ins->series_file, "");
+    mpc_conf_merge_str_value(ins->success_codes, tmp_ins->success_codes,
+                             MPC_HTTP_DEFAULT_SUCCESS);
+    mpc_conf_merge_str_value(ins->sweep_concurrency,
+                             tmp_ins->sweep_concurrency, "");
     mpc_conf_merge_str_value(ins->log_file, tmp_ins->log_file, "");
+    mpc_conf_merge_str_value(ins->unix_socket, tmp_ins->unix_socket, "");
 
     mpc_conf_merge_value(ins->log_level, tmp_ins->log_level, MPC_LOG_INFO);
     mpc_conf_merge_value(ins->http_method, tmp_ins->http_method, 
                          MPC_HTTP_METHOD_GET);
+    mpc_conf_merge_value(ins->output_format, tmp_ins->output_format,
+                         MPC_STAT_FORMAT_TEXT);
     mpc_conf_merge_uint_value(ins->concurrency, tmp_ins->concurrency, 
                               MPC_DEFAULT_CONCURRENCY);
     mpc_conf_merge_uint_value(ins->run_time, tmp_ins->run_time, 0);
+    mpc_conf_merge_uint_value(ins->interval, tmp_ins->interval, 0);
+    mpc_conf_merge_uint_value(ins->warmup, tmp_ins->warmup, 0);
+    mpc_conf_merge_uint_value(ins->warmup_requests, tmp_ins->warmup_requests,
+                              0);
+    mpc_conf_merge_uint_value(ins->slo_tolerance, tmp_ins->slo_tolerance, 0);
+    mpc_conf_merge_uint_value(ins->sweep_step, tmp_ins->sweep_step,
+                              MPC_SWEEP_DEFAULT_STEP);
     mpc_conf_merge_value(ins->follow_location, tmp_ins->follow_location,
                          MPC_CONF_UNSET);
     mpc_conf_merge_value(ins->replay, tmp_ins->replay, 0);
+    mpc_conf_merge_value(ins->precise_time, tmp_ins->precise_time, 0);
+    mpc_conf_merge_value(ins->keepalive, tmp_ins->keepalive, 0);
+    mpc_conf_merge_value(ins->reset_close, tmp_ins->reset_close, 0);
+    mpc_conf_merge_value(ins->server_close, tmp_ins->server_close, 0);
+    mpc_conf_merge_uint_value(ins->pipeline, tmp_ins->pipeline, 1);
+    mpc_conf_merge_uint_value(ins->host_concurrency, tmp_ins->host_concurrency,
+                              0);
+    mpc_conf_merge_uint_value(ins->host_idle, tmp_ins->host_idle, 0);
+    mpc_conf_merge_uint_value(ins->connect_timeout, tmp_ins->connect_timeout,
+                              MPC_DEFAULT_CONNECT_TIMEOUT);
+    mpc_conf_merge_uint_value(ins->read_timeout, tmp_ins->read_timeout,
+                              MPC_DEFAULT_READ_TIMEOUT);
+    mpc_conf_merge_uint_value(ins->timeout, tmp_ins->timeout, 0);
+    mpc_conf_merge_uint_value(ins->event_batch, tmp_ins->event_batch,
+                              MPC_DEFAULT_EVENT_BATCH);
+
+    if (ins->event_batch < 1 || ins->event_batch > MPC_MAX_INT32_VALUE) {
+        ins->event_batch = MPC_DEFAULT_EVENT_BATCH;
+    }
+    mpc_conf_merge_value(ins->tcp_nodelay, tmp_ins->tcp_nodelay, 0);
+    mpc_conf_merge_value(ins->tcp_quickack, tmp_ins->tcp_quickack, 0);
+    mpc_conf_merge_value(ins->fastopen, tmp_ins->fastopen, 0);
+    mpc_conf_merge_value(ins->prefer_ipv6, tmp_ins->prefer_ipv6, 0);
+    mpc_conf_merge_size_value(ins->rcvbuf, tmp_ins->rcvbuf, 0);
+    mpc_conf_merge_size_value(ins->sndbuf, tmp_ins->sndbuf, 0);
+    mpc_conf_merge_uint_value(ins->tcp_user_timeout, tmp_ins->tcp_user_timeout,
+                              0);
+    mpc_conf_merge_str_value(ins->tcp_congestion, tmp_ins->tcp_congestion, "");
+
+    if (ins->pipeline > MPC_MAX_PIPELINE) {
+        ins->pipeline = MPC_MAX_PIPELINE;
+    }
+
+    /* pipelined requests go on kept connections */
+    if (ins->pipeline > 1) {
+        ins->keepalive = 1;
+    }
 
     if (ins->use_addr == 0 && tmp_ins->use_addr) {
         ins->use_addr = 1;
         ins->addr = tmp_ins->addr;
     }
+
+    if (!ins->sweep_target_set && tmp_ins->sweep_target_set) {
+        ins->sweep_target = tmp_ins->sweep_target;
+        ins->sweep_target_set = 1;
+    }
+
+    /* objectives given on the command line replace those configured */
+    if (ins->slos == NULL) {
+        ins->slos = tmp_ins->slos;
+
+    } else if (tmp_ins->slos != NULL) {
+        mpc_array_destroy(tmp_ins->slos);
+    }
+
+    tmp_ins->slos = NULL;
+
+    if (ins->sources == NULL) {
+        ins->sources = tmp_ins->sources;
+
+    } else if (tmp_ins->sources != NULL) {
+        mpc_array_destroy(tmp_ins->sources);
+    }
+
+    tmp_ins->sources = NULL;
+
+    ins->sockopts.nodelay = ins->tcp_nodelay ? 1 : 0;
+    ins->sockopts.quickack = ins->tcp_quickack ? 1 : 0;
+    ins->sockopts.rcvbuf = (int) MPC_MIN(ins->rcvbuf, MPC_MAX_INT32_VALUE);
+    ins->sockopts.sndbuf = (int) MPC_MIN(ins->sndbuf, MPC_MAX_INT32_VALUE);
+    ins->sockopts.user_timeout = (unsigned) ins->tcp_user_timeout;
+    ins->sockopts.congestion = ins->tcp_congestion.len ?
+                               (char *) ins->tcp_congestion.data : NULL;
+    ins->sockopts.fastopen = ins->fastopen ? 1 : 0;
+
+    /* the options of TCP have no meaning on a unix domain socket */
+    if (ins->unix_socket.len) {
+        mpc_memzero(&ins->sockopts, sizeof(mpc_net_sockopts_t));
+    }
 }
 
 
@@ -455,24 +1322,60 @@ mpc_instance_init(mpc_instance_t *ins)
     mpc_str_null(&ins->url_file);
     mpc_str_null(&ins->result_file);
     mpc_str_null(&ins->result_mark);
+    mpc_str_null(&ins->series_file);
+    mpc_str_null(&ins->success_codes);
+    mpc_str_null(&ins->sweep_concurrency);
     mpc_str_null(&ins->log_file);
+    mpc_str_null(&ins->tcp_congestion);
+    mpc_str_null(&ins->unix_socket);
 
     ins->log_level = MPC_CONF_UNSET;
     ins->http_method = MPC_CONF_UNSET;
+    ins->output_format = MPC_CONF_UNSET;
     ins->concurrency = MPC_CONF_UNSET_UINT;
     ins->run_time = MPC_CONF_UNSET_UINT;
+    ins->interval = MPC_CONF_UNSET_UINT;
+    ins->warmup = MPC_CONF_UNSET_UINT;
+    ins->warmup_requests = MPC_CONF_UNSET_UINT;
+    ins->slo_tolerance = MPC_CONF_UNSET_UINT;
+    ins->sweep_step = MPC_CONF_UNSET_UINT;
+    ins->pipeline = MPC_CONF_UNSET_UINT;
+    ins->host_concurrency = MPC_CONF_UNSET_UINT;
+    ins->host_idle = MPC_CONF_UNSET_UINT;
+    ins->connect_timeout = MPC_CONF_UNSET_UINT;
+    ins->read_timeout = MPC_CONF_UNSET_UINT;
+    ins->timeout = MPC_CONF_UNSET_UINT;
+    ins->event_batch = MPC_CONF_UNSET_UINT;
+    ins->tcp_nodelay = MPC_CONF_UNSET;
+    ins->tcp_quickack = MPC_CONF_UNSET;
+    ins->fastopen = MPC_CONF_UNSET;
+    ins->prefer_ipv6 = MPC_CONF_UNSET;
+    ins->rcvbuf = MPC_CONF_UNSET_SIZE;
+    ins->sndbuf = MPC_CONF_UNSET_SIZE;
+    ins->tcp_user_timeout = MPC_CONF_UNSET_UINT;
 
     ins->follow_location = MPC_CONF_UNSET;
     ins->replay = MPC_CONF_UNSET;
+    ins->precise_time = MPC_CONF_UNSET;
+    ins->keepalive = MPC_CONF_UNSET;
+    ins->reset_close = MPC_CONF_UNSET;
+    ins->server_close = MPC_CONF_UNSET;
 
     ins->use_addr = 0;
     ins->http_count = 0;
     TAILQ_INIT(&ins->http_hdr);
 
     ins->urls = NULL;
+    ins->hosts = NULL;
+    ins->slos = NULL;
+    ins->sources = NULL;
+    ins->sweep_target_set = 0;
+    ins->sweep = NULL;
+    ins->slo_broken = 0;
     ins->el = NULL;
     ins->self_pipe[0] = -1;
     ins->self_pipe[1] = -1;
+    ins->series_fd = -1;
     ins->stat = NULL;
 }
 
@@ -480,7 +1383,7 @@ mpc_instance_init(mpc_instance_t *ins)
 int 
 main(int argc, char **argv)
 {
-    int             fd;
+    int             fd, rc;
     mpc_conf_t      conf;
     mpc_instance_t  tmp_ins;
 
@@ -511,10 +1414,10 @@ main(int argc, char **argv)
         exit(0);
     }
 
-    if (mpc_ins->conf_file.len != 0) {
-        mpc_memzero(&tmp_ins, sizeof(mpc_instance_t));
-        mpc_instance_init(mpc_ins);
+    mpc_memzero(&tmp_ins, sizeof(mpc_instance_t));
+    mpc_instance_init(&tmp_ins);
 
+    if (mpc_ins->conf_file.len != 0) {
         mpc_memzero(&conf, sizeof(mpc_conf_t));
         conf.ctx = (void *)&tmp_ins;
         conf.commands = mpc_conf_commands;
@@ -522,16 +1425,32 @@ main(int argc, char **argv)
         if (mpc_conf_parse(&conf, &mpc_ins->conf_file) != MPC_OK) {
             exit(0);
         }
-
-        mpc_instance_merge(mpc_ins, &tmp_ins);
     }
 
+    mpc_instance_merge(mpc_ins, &tmp_ins);
+
     if (mpc_ins->url_file.len == 0) {
         mpc_log_stderr(errno, "no url file specified");
         mpc_show_usage();
         exit(1);
     }
 
+    if (mpc_http_parse_status_codes(mpc_ins->success,
+                                    mpc_ins->success_codes.data,
+                                    mpc_ins->success_codes.len)
+        != MPC_OK)
+    {
+        mpc_log_stderr(0, "invalid success codes \"%V\"",
+                       &mpc_ins->success_codes);
+        exit(1);
+    }
+
+    if (mpc_ins->sweep_concurrency.len != 0
+        && mpc_init_sweep(mpc_ins) != MPC_OK)
+    {
+        exit(1);
+    }
+
     mpc_rlimit_reset();
 
     mpc_ins->stat = mpc_stat_create();
@@ -552,13 +1471,23 @@ main(int argc, char **argv)
         exit(1);
     }
 
+    mpc_ins->stat->time_wait = mpc_net_time_wait();
+
     mpc_stat_print(mpc_ins->stat);
 
+    if (mpc_ins->slos != NULL) {
+        mpc_stat_slo_print(mpc_ins->slos, mpc_ins->slo_tolerance);
+    }
+
+    if (mpc_ins->sweep != NULL) {
+        mpc_sweep_print(mpc_ins->sweep);
+    }
+
     if (mpc_ins->result_file.len != 0) {
-        fd = mpc_stat_result_create((char *)mpc_ins->result_file.data);
+        fd = mpc_stat_result_create((char *)mpc_ins->result_file.data,
+                                    mpc_ins->output_format);
         if (fd != MPC_ERROR) {
-            mpc_stat_result_record(fd, mpc_ins->stat, 
-                                   (char *)mpc_ins->result_mark.data);
+            mpc_stat_result_record(fd, mpc_ins, 0);
             mpc_stat_result_close(fd);
         }
     }
@@ -569,28 +1498,94 @@ main(int argc, char **argv)
         mpc_conf_free(&conf);
     }
 
+    rc = mpc_ins->slo_broken ? MPC_EXIT_SLO : 0;
+
+    if (mpc_ins->slos != NULL) {
+        mpc_array_destroy(mpc_ins->slos);
+    }
+
+    if (mpc_ins->sources != NULL) {
+        mpc_array_destroy(mpc_ins->sources);
+    }
+
+    if (mpc_ins->sweep != NULL) {
+        mpc_sweep_destroy(mpc_ins->sweep);
+    }
+
     mpc_free(mpc_ins);
 
-    exit(0);
+    exit(rc);
 }
 
 
 void
 mpc_stop()
 {
-    mpc_ins->stat->stop = mpc_time_ms();
+    mpc_ins->stat->stop = mpc_time_monotonic_us();
     mpc_event_stop(mpc_ins->el, 0);
 }
 
 
+static int
+mpc_init_sweep(mpc_instance_t *ins)
+{
+    mpc_sweep_t  *sweep;
+
+    if (ins->replay) {
+        mpc_log_stderr(0, "a sweep can not replay the url file");
+        return MPC_ERROR;
+    }
+
+    sweep = mpc_sweep_create(ins->sweep_concurrency.data,
+                             ins->sweep_concurrency.len);
+    if (sweep == NULL) {
+        mpc_log_stderr(0, "invalid sweep concurrency \"%V\"",
+                       &ins->sweep_concurrency);
+        return MPC_ERROR;
+    }
+
+    ins->sweep = sweep;
+    sweep->step_time = ins->sweep_step;
+
+    /* the first fill and the warm-up already run at the first step */
+    ins->concurrency = sweep->current;
+
+    if (ins->sweep_target_set) {
+        sweep->target = ins->sweep_target;
+        sweep->has_target = 1;
+
+    } else if (sweep->search) {
+        mpc_log_stderr(0, "searching a range needs a sweep target");
+        return MPC_ERROR;
+    }
+
+    return MPC_OK;
+}
+
+
 static void
 mpc_rlimit_reset()
 {
     struct rlimit  rlim;
 
-    rlim.rlim_cur = MPC_MAX_OPENFILES;
-    rlim.rlim_max = MPC_MAX_OPENFILES;
-    setrlimit(RLIMIT_NOFILE, &rlim);
+    /*
+     * the soft limit goes up to the hard one, root may raise the hard
+     * one too, up to fs.nr_open
+     */
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+        if (rlim.rlim_max < MPC_MAX_OPENFILES) {
+            rlim.rlim_cur = MPC_MAX_OPENFILES;
+            rlim.rlim_max = MPC_MAX_OPENFILES;
+
+            if (setrlimit(RLIMIT_NOFILE, &rlim) != 0) {
+                getrlimit(RLIMIT_NOFILE, &rlim);
+            }
+        }
+
+        rlim.rlim_cur = rlim.rlim_max == RLIM_INFINITY
+                        ? MPC_MAX_OPENFILES : rlim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rlim);
+    }
 
     rlim.rlim_cur = 1 << 29;
     rlim.rlim_max = 1 << 29;
@@ -0,0 +1,763 @@
+/*
+ * mpc -- A Multiple Protocol Client.
+ * Copyright (c) 2013, FengGu <flygoast@gmail.com>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/*
+ * mpc-compare reads the records appended to result files by mpc -R, in
+ * any output format, and compares the last one against all the records
+ * before it.
+ */
+
+
+#include <getopt.h>
+#include <math.h>
+#include <mpc_core.h>
+
+
+#define MPC_COMPARE_THRESHOLD       5.0     /* percent */
+#define MPC_COMPARE_SIGMA           3.0
+#define MPC_COMPARE_ERROR_FLOOR     0.1     /* percentage points */
+
+#define MPC_COMPARE_RATE            0
+#define MPC_COMPARE_THROUGHPUT      1
+#define MPC_COMPARE_ERRORS          2
+#define MPC_COMPARE_P50             3
+#define MPC_COMPARE_P90             4
+#define MPC_COMPARE_P99             5
+#define MPC_COMPARE_P999            6
+#define MPC_COMPARE_NMETRICS        7
+
+#define MPC_COMPARE_OK              0
+#define MPC_COMPARE_FAILED          1
+#define MPC_COMPARE_REGRESSION      2
+
+
+typedef struct {
+    char      *name;
+    double     percentile;          /* latency metrics only */
+    unsigned   higher_better:1;
+    unsigned   absolute:1;          /* compared in percentage points */
+} mpc_compare_metric_t;
+
+
+typedef struct {
+    char       mark[64];
+    unsigned   hist:1;              /* percentiles from a distribution */
+    unsigned   snapshot:1;          /* written on SIGUSR1, not a whole run */
+    double     value[MPC_COMPARE_NMETRICS];
+} mpc_compare_record_t;
+
+
+/* a latency histogram as written in json, [lowest, highest, count] */
+typedef struct {
+    uint64_t   count;
+    uint64_t   min;
+    uint64_t   max;
+    uint32_t   nbuckets;
+    uint64_t   highest[MPC_STAT_HIST_NBUCKETS];
+    uint64_t   counts[MPC_STAT_HIST_NBUCKETS];
+} mpc_compare_hist_t;
+
+
+static mpc_compare_metric_t  metrics[MPC_COMPARE_NMETRICS] = {
+    { "Trans rate (/sec)",  0,    1, 0 },
+    { "Throughput (MB/sec)", 0,   1, 0 },
+    { "Failed (%)",         0,    0, 1 },
+    { "P50 (secs)",         50,   0, 0 },
+    { "P90 (secs)",         90,   0, 0 },
+    { "P99 (secs)",         99,   0, 0 },
+    { "P99.9 (secs)",       99.9, 0, 0 },
+};
+
+
+static struct option  long_options[] = {
+    { "help",            no_argument,        NULL,   'h' },
+    { "threshold",       required_argument,  NULL,   't' },
+    { "sigma",           required_argument,  NULL,   'k' },
+    { NULL,              0,                  NULL,    0  }
+};
+
+
+static char *short_options = "ht:k:";
+
+
+static double                threshold = MPC_COMPARE_THRESHOLD;
+static double                sigma = MPC_COMPARE_SIGMA;
+static mpc_compare_hist_t    hist;
+
+
+static void
+mpc_compare_show_usage(void)
+{
+    printf("Usage: mpc-compare [-h] [-t threshold] [-k sigma] "
+           "result file..." CRLF
+           CRLF
+           "Compare the last record of the result files against the "
+           "records before it." CRLF
+           "Exit with %d when it regressed." CRLF
+           CRLF
+           "Options:" CRLF
+           "  -h, --help            : this help" CRLF
+           "  -t, --threshold=N     : tolerated change in percent, "
+           "default %.0f" CRLF
+           "  -k, --sigma=N         : tolerated change in standard "
+           "deviations" CRLF
+           "                          of the baseline, default %.0f" CRLF
+           CRLF,
+           MPC_COMPARE_REGRESSION, MPC_COMPARE_THRESHOLD, MPC_COMPARE_SIGMA);
+}
+
+
+static void
+mpc_compare_json_ws(char **p)
+{
+    while (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n') {
+        (*p)++;
+    }
+}
+
+
+static int
+mpc_compare_json_string(char **p, char **start, size_t *len)
+{
+    char  *s = *p;
+
+    if (*s != '"') {
+        return MPC_ERROR;
+    }
+
+    *start = ++s;
+
+    while (*s != '"') {
+        if (*s == '\0') {
+            return MPC_ERROR;
+        }
+
+        if (*s == '\\' && s[1] != '\0') {
+            s++;
+        }
+
+        s++;
+    }
+
+    *len = s - *start;
+    *p = s + 1;
+
+    return MPC_OK;
+}
+
+
+static int
+mpc_compare_json_skip(char **p)
+{
+    char    *s;
+    size_t   len;
+    int      depth;
+
+    mpc_compare_json_ws(p);
+
+    if (**p == '"') {
+        return mpc_compare_json_string(p, &s, &len);
+    }
+
+    if (**p != '{' && **p != '[') {
+        /* number, true, false or null */
+        while (**p != '\0' && **p != ',' && **p != '}' && **p != ']') {
+            (*p)++;
+        }
+
+        return MPC_OK;
+    }
+
+    depth = 0;
+
+    for ( ;; ) {
+        switch (**p) {
+        case '\0':
+            return MPC_ERROR;
+
+        case '"':
+            if (mpc_compare_json_string(p, &s, &len) != MPC_OK) {
+                return MPC_ERROR;
+            }
+            continue;
+
+        case '{':
+        case '[':
+            depth++;
+            break;
+
+        case '}':
+        case ']':
+            if (--depth == 0) {
+                (*p)++;
+                return MPC_OK;
+            }
+            break;
+        }
+
+        (*p)++;
+    }
+}
+
+
+/* find the value of the member key of the object at obj */
+static char *
+mpc_compare_json_member(char *obj, char *key)
+{
+    char    *p, *name;
+    size_t   len;
+
+    p = obj;
+    mpc_compare_json_ws(&p);
+
+    if (*p++ != '{') {
+        return NULL;
+    }
+
+    for ( ;; ) {
+        mpc_compare_json_ws(&p);
+
+        if (mpc_compare_json_string(&p, &name, &len) != MPC_OK) {
+            return NULL;
+        }
+
+        mpc_compare_json_ws(&p);
+
+        if (*p++ != ':') {
+            return NULL;
+        }
+
+        mpc_compare_json_ws(&p);
+
+        if (len == strlen(key) && strncmp(name, key, len) == 0) {
+            return p;
+        }
+
+        if (mpc_compare_json_skip(&p) != MPC_OK) {
+            return NULL;
+        }
+
+        mpc_compare_json_ws(&p);
+
+        if (*p++ != ',') {
+            return NULL;
+        }
+    }
+}
+
+
+static double
+mpc_compare_json_number(char *obj, char *key)
+{
+    char  *p, *end;
+    double v;
+
+    p = mpc_compare_json_member(obj, key);
+    if (p == NULL) {
+        return NAN;
+    }
+
+    v = strtod(p, &end);
+    if (end == p) {
+        return NAN;
+    }
+
+    return v;
+}
+
+
+static int
+mpc_compare_json_hist(char *obj, mpc_compare_hist_t *h)
+{
+    char    *p, *end;
+    int      i;
+    double   v[3];
+
+    h->count = (uint64_t) mpc_compare_json_number(obj, "count");
+    h->min = (uint64_t) mpc_compare_json_number(obj, "min");
+    h->max = (uint64_t) mpc_compare_json_number(obj, "max");
+    h->nbuckets = 0;
+
+    p = mpc_compare_json_member(obj, "buckets");
+    if (p == NULL || *p++ != '[') {
+        return MPC_ERROR;
+    }
+
+    for ( ;; ) {
+        mpc_compare_json_ws(&p);
+
+        if (*p == ']') {
+            return MPC_OK;
+        }
+
+        if (*p == ',') {
+            p++;
+            continue;
+        }
+
+        if (*p++ != '[') {
+            return MPC_ERROR;
+        }
+
+        for (i = 0; i < 3; i++) {
+            mpc_compare_json_ws(&p);
+            v[i] = strtod(p, &end);
+            if (end == p) {
+                return MPC_ERROR;
+            }
+
+            p = end;
+            mpc_compare_json_ws(&p);
+
+            if (*p == ',') {
+                p++;
+            }
+        }
+
+        if (*p++ != ']' || h->nbuckets == MPC_STAT_HIST_NBUCKETS) {
+            return MPC_ERROR;
+        }
+
+        h->highest[h->nbuckets] = (uint64_t) v[1];
+        h->counts[h->nbuckets] = (uint64_t) v[2];
+        h->nbuckets++;
+    }
+}
+
+
+/* the same as mpc_stat_hist_percentile() does, in seconds */
+static double
+mpc_compare_hist_percentile(mpc_compare_hist_t *h, double percentile)
+{
+    uint64_t  rank, seen, value;
+    uint32_t  i;
+
+    if (h->count == 0) {
+        return 0;
+    }
+
+    rank = (uint64_t) (percentile / 100 * h->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    value = h->max;
+
+    if (rank < h->count) {
+        seen = 0;
+
+        for (i = 0; i < h->nbuckets; i++) {
+            seen += h->counts[i];
+
+            if (seen >= rank) {
+                value = MPC_MAX(MPC_MIN(h->highest[i], h->max), h->min);
+                break;
+            }
+        }
+    }
+
+    return value / (double)1000000;
+}
+
+
+static int
+mpc_compare_snapshot(char *mark, size_t len)
+{
+    size_t  n;
+
+    n = sizeof(MPC_STAT_SNAPSHOT_MARK) - 1;
+
+    return len >= n && memcmp(mark + len - n, MPC_STAT_SNAPSHOT_MARK, n) == 0;
+}
+
+
+static int
+mpc_compare_parse_json(char *line, mpc_compare_record_t *r)
+{
+    char    *p, *s;
+    size_t   len;
+    int      i;
+    double   ok, failed, elapsed;
+
+    p = mpc_compare_json_member(line, "mark");
+    if (p != NULL && mpc_compare_json_string(&p, &s, &len) == MPC_OK) {
+        snprintf(r->mark, sizeof(r->mark), "%.*s", (int) len, s);
+    }
+
+    p = mpc_compare_json_member(line, "snapshot");
+    r->snapshot = (p != NULL && strncmp(p, "true", 4) == 0);
+
+    ok = mpc_compare_json_number(line, "ok");
+    failed = mpc_compare_json_number(line, "failed");
+    elapsed = mpc_compare_json_number(line, "elapsed") / 1000000;
+
+    if (isnan(ok) || isnan(failed) || isnan(elapsed) || elapsed <= 0) {
+        return MPC_ERROR;
+    }
+
+    r->value[MPC_COMPARE_RATE] = (ok + failed) / elapsed;
+    r->value[MPC_COMPARE_THROUGHPUT] =
+        mpc_compare_json_number(line, "bytes") / (1024 * 1024) / elapsed;
+    r->value[MPC_COMPARE_ERRORS] = failed * 100 / (ok + failed);
+
+    p = mpc_compare_json_member(line, "histograms");
+    if (p != NULL) {
+        p = mpc_compare_json_member(p, "latency");
+    }
+
+    if (p != NULL && mpc_compare_json_hist(p, &hist) == MPC_OK) {
+        r->hist = 1;
+
+        for (i = MPC_COMPARE_P50; i < MPC_COMPARE_NMETRICS; i++) {
+            r->value[i] = mpc_compare_hist_percentile(&hist,
+                                                      metrics[i].percentile);
+        }
+
+        return MPC_OK;
+    }
+
+    p = mpc_compare_json_member(line, "percentiles");
+    if (p != NULL) {
+        r->value[MPC_COMPARE_P50] = mpc_compare_json_number(p, "50") / 1000000;
+        r->value[MPC_COMPARE_P90] = mpc_compare_json_number(p, "90") / 1000000;
+        r->value[MPC_COMPARE_P99] = mpc_compare_json_number(p, "99") / 1000000;
+        r->value[MPC_COMPARE_P999] =
+            mpc_compare_json_number(p, "99.9") / 1000000;
+    }
+
+    return MPC_OK;
+}
+
+
+/*
+ * A text or csv row: after the date come transactions, elapsed time,
+ * data transferred, response time, transaction rate, throughput,
+ * concurrency, okay, failed and, since they are recorded, the
+ * percentiles 50, 90, 99 and 99.9.
+ */
+static int
+mpc_compare_parse_row(char *line, mpc_compare_record_t *r)
+{
+    char    *p, *end;
+    double   v[13];
+    int      n;
+
+    p = strchr(line, ',');
+    if (p == NULL) {
+        return MPC_ERROR;
+    }
+
+    for (n = 0; n < 13 && p != NULL; n++) {
+        v[n] = strtod(p + 1, &end);
+        if (end == p + 1) {
+            break;
+        }
+
+        p = strchr(end, ',');
+    }
+
+    if (n < 9) {
+        return MPC_ERROR;
+    }
+
+    r->value[MPC_COMPARE_RATE] = v[4];
+    r->value[MPC_COMPARE_THROUGHPUT] = v[5];
+    r->value[MPC_COMPARE_ERRORS] = v[8] * 100 / (v[7] + v[8]);
+
+    if (n == 13) {
+        r->value[MPC_COMPARE_P50] = v[9];
+        r->value[MPC_COMPARE_P90] = v[10];
+        r->value[MPC_COMPARE_P99] = v[11];
+        r->value[MPC_COMPARE_P999] = v[12];
+    }
+
+    return MPC_OK;
+}
+
+
+static int
+mpc_compare_load(char *file, mpc_array_t *records)
+{
+    FILE                  *fp;
+    char                  *line, *p, *s;
+    size_t                 size, len;
+    ssize_t                n;
+    int                    i, rc, snapshot;
+    char                   mark[64];
+    mpc_compare_record_t  *r;
+
+    fp = fopen(file, "r");
+    if (fp == NULL) {
+        mpc_log_stderr(errno, "fopen \"%s\" failed", file);
+        return MPC_ERROR;
+    }
+
+    line = NULL;
+    size = 0;
+    mark[0] = '\0';
+    snapshot = 0;
+
+    while ((n = getline(&line, &size, fp)) != -1) {
+        if (n > 0 && line[n - 1] == '\n') {
+            line[--n] = '\0';
+        }
+
+        if (strncmp(line, "**** ", 5) == 0) {
+            /* the mark of the text row to come */
+            snprintf(mark, sizeof(mark), "%.*s",
+                     n > 10 ? (int) n - 10 : 0, line + 5);
+            snapshot = mpc_compare_snapshot(line + 5, n > 10 ? n - 10 : 0);
+            continue;
+        }
+
+        if (line[0] != '{' && line[0] != '"'
+            && (line[0] < '0' || line[0] > '9'))
+        {
+            /* a head line */
+            continue;
+        }
+
+        r = mpc_array_push(records);
+        if (r == NULL) {
+            mpc_log_stderr(errno, "oom!");
+            break;
+        }
+
+        r->hist = 0;
+        r->snapshot = snapshot;
+        for (i = 0; i < MPC_COMPARE_NMETRICS; i++) {
+            r->value[i] = NAN;
+        }
+
+        snprintf(r->mark, sizeof(r->mark), "%s", mark);
+        mark[0] = '\0';
+        snapshot = 0;
+
+        if (line[0] == '{') {
+            rc = mpc_compare_parse_json(line, r);
+
+        } else {
+            p = line;
+
+            if (line[0] == '"') {
+                /* csv starts with the mark, skip it */
+                if (mpc_compare_json_string(&p, &s, &len) != MPC_OK
+                    || *p++ != ',')
+                {
+                    p = "";
+
+                } else {
+                    snprintf(r->mark, sizeof(r->mark), "%.*s", (int) len, s);
+                    r->snapshot = mpc_compare_snapshot(s, len);
+                }
+            }
+
+            rc = mpc_compare_parse_row(p, r);
+        }
+
+        if (rc != MPC_OK) {
+            mpc_log_stderr(0, "invalid record in \"%s\", ignored", file);
+            mpc_array_pop(records);
+
+        } else if (r->snapshot) {
+            /* the statistics of a run not over yet skew the baseline */
+            mpc_array_pop(records);
+        }
+    }
+
+    free(line);
+    fclose(fp);
+
+    return MPC_OK;
+}
+
+
+static int
+mpc_compare_records(mpc_array_t *records)
+{
+    uint32_t               i, k, n;
+    int                    regressed;
+    double                 sum, mean, dev, delta, allowed, v;
+    char                  *verdict;
+    mpc_compare_record_t  *r, *last;
+
+    last = mpc_array_top(records);
+
+    printf("Baseline:  %u records" CRLF
+           "Candidate: record %u%s%s%s" CRLF
+           CRLF
+           "%-20s %12s %12s %12s %10s %10s" CRLF,
+           records->nelem - 1, records->nelem,
+           last->mark[0] ? " \"" : "", last->mark, last->mark[0] ? "\"" : "",
+           "", "Baseline", "Stddev", "Candidate", "Delta", "Allowed");
+
+    regressed = 0;
+
+    for (k = 0; k < MPC_COMPARE_NMETRICS; k++) {
+        if (isnan(last->value[k])) {
+            continue;
+        }
+
+        sum = 0;
+        n = 0;
+
+        for (i = 0; i < records->nelem - 1; i++) {
+            r = mpc_array_get(records, i);
+            if (!isnan(r->value[k])) {
+                sum += r->value[k];
+                n++;
+            }
+        }
+
+        if (n == 0) {
+            continue;
+        }
+
+        mean = sum / n;
+        dev = 0;
+
+        if (n > 1) {
+            sum = 0;
+
+            for (i = 0; i < records->nelem - 1; i++) {
+                r = mpc_array_get(records, i);
+                if (!isnan(r->value[k])) {
+                    sum += (r->value[k] - mean) * (r->value[k] - mean);
+                }
+            }
+
+            dev = sqrt(sum / (n - 1));
+        }
+
+        v = last->value[k];
+
+        /*
+         * a change is a regression only when it is beyond both the
+         * threshold and the noise seen between the baseline records
+         */
+        if (metrics[k].absolute) {
+            delta = v - mean;
+            allowed = MPC_MAX(MPC_COMPARE_ERROR_FLOOR, sigma * dev);
+
+        } else {
+            delta = mean != 0 ? (v - mean) / mean * 100 : 0;
+            allowed = mean != 0 ? MPC_MAX(threshold, sigma * dev / mean * 100)
+                                : threshold;
+        }
+
+        verdict = "ok";
+
+        if (metrics[k].higher_better ? delta < -allowed : delta > allowed) {
+            verdict = "REGRESSION";
+            regressed = 1;
+
+        } else if (metrics[k].higher_better ? delta > allowed
+                                            : delta < -allowed)
+        {
+            verdict = "improved";
+        }
+
+        printf("%-20s %12.6f %12.6f %12.6f %+9.2f%s %9.2f%s  %s" CRLF,
+               metrics[k].name, mean, dev, v,
+               delta, metrics[k].absolute ? "p" : "%",
+               allowed, metrics[k].absolute ? "p" : "%",
+               verdict);
+    }
+
+    printf(CRLF "%s" CRLF, regressed ? "Regression detected" : "No regression");
+
+    return regressed ? MPC_COMPARE_REGRESSION : MPC_COMPARE_OK;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    int           c;
+    mpc_array_t  *records;
+
+    opterr = 0;
+
+    while ((c = getopt_long(argc, argv, short_options, long_options, NULL))
+           != -1)
+    {
+        switch (c) {
+        case 'h':
+            mpc_compare_show_usage();
+            exit(MPC_COMPARE_OK);
+
+        case 't':
+            threshold = atof(optarg);
+            if (threshold < 0) {
+                mpc_log_stderr(0, "option '-t' requires a positive number");
+                exit(MPC_COMPARE_FAILED);
+            }
+            break;
+
+        case 'k':
+            sigma = atof(optarg);
+            if (sigma < 0) {
+                mpc_log_stderr(0, "option '-k' requires a positive number");
+                exit(MPC_COMPARE_FAILED);
+            }
+            break;
+
+        default:
+            mpc_log_stderr(0, "invalid option -- '%c'", optopt);
+            mpc_compare_show_usage();
+            exit(MPC_COMPARE_FAILED);
+        }
+    }
+
+    if (optind == argc) {
+        mpc_compare_show_usage();
+        exit(MPC_COMPARE_FAILED);
+    }
+
+    records = mpc_array_create(16, sizeof(mpc_compare_record_t));
+    if (records == NULL) {
+        mpc_log_stderr(errno, "oom!");
+        exit(MPC_COMPARE_FAILED);
+    }
+
+    for (; optind < argc; optind++) {
+        if (mpc_compare_load(argv[optind], records) != MPC_OK) {
+            exit(MPC_COMPARE_FAILED);
+        }
+    }
+
+    if (records->nelem < 2) {
+        mpc_log_stderr(0, "at least two records are needed, %u found",
+                       records->nelem);
+        exit(MPC_COMPARE_FAILED);
+    }
+
+    exit(mpc_compare_records(records));
+}
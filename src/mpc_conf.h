@@ -256,9 +256,9 @@ char *mpc_conf_set_str_array_slot(mpc_conf_t *cf, mpc_command_t *cmd,
 char *mpc_conf_set_str_keyval_slot(mpc_conf_t *cf, mpc_command_t *cmd,
     void *conf);
 char *mpc_conf_set_num_slot(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
-char *mpc_conf_set_str_size_slot(mpc_conf_t *cf, mpc_command_t *cmd,
+char *mpc_conf_set_size_slot(mpc_conf_t *cf, mpc_command_t *cmd,
     void *conf);
-char *mpc_conf_set_str_msec_slot(mpc_conf_t *cf, mpc_command_t *cmd,
+char *mpc_conf_set_msec_slot(mpc_conf_t *cf, mpc_command_t *cmd,
     void *conf);
 char *mpc_conf_set_str_sec_slot(mpc_conf_t *cf, mpc_command_t *cmd, void *conf);
 char *mpc_conf_set_str_enum_slot(mpc_conf_t *cf, mpc_command_t *cmd,
@@ -177,10 +177,17 @@ mpc_conn_default(mpc_conn_t *conn)
 
     conn->rcv_bytes = 0;
     conn->snd_bytes = 0;
+    conn->pool = NULL;
 
+    TAILQ_INIT(&conn->requests);
+    conn->nrequests = 0;
+    conn->timer.hdr = NULL;
+
+    conn->ready = 0;
     conn->keepalive = 0;
     conn->connecting = 0;
     conn->connected = 0;
+    conn->fastopen = 0;
     conn->eof = 0;
     conn->done = 0;
 }
@@ -193,6 +200,17 @@ mpc_conn_send(mpc_conn_t *conn)
 
     sum = 0;
     for (;;) {
+        /* a buffer left empty by a rewind, the requests are further on */
+        if (conn->snd_buf->pos == conn->snd_buf->last) {
+            conn->snd_buf = STAILQ_NEXT(conn->snd_buf, next);
+            if (conn->snd_buf == NULL) {
+                conn->done = 1;
+                break;
+            }
+
+            continue;
+        }
+
         n = write(conn->fd, conn->snd_buf->pos, 
                   conn->snd_buf->last - conn->snd_buf->pos);
         if (n < 0) {
@@ -200,7 +218,8 @@ mpc_conn_send(mpc_conn_t *conn)
                 continue;
             }
 
-            if (errno == EAGAIN) {
+            /* fast open without a cookie, the data follows the handshake */
+            if (errno == EAGAIN || errno == EINPROGRESS) {
                 n = 0;
                 break;
             }
@@ -252,6 +271,8 @@ mpc_conn_release(mpc_conn_t *conn)
         close(conn->fd);
     }
 
+    mpc_timer_del(&conn->timer);
+
     mpc_conn_put(conn);
 }
 
@@ -270,6 +291,37 @@ mpc_conn_buf_rewind(mpc_conn_t *conn)
 }
 
 
+void
+mpc_conn_rcv_buf_rewind(mpc_conn_t *conn)
+{
+    mpc_buf_queue_rewind(&conn->rcv_buf_queue);
+
+    conn->rcv_buf = STAILQ_FIRST(&conn->rcv_buf_queue);
+}
+
+
+/*
+ * Move the buffers before buf, which were read in full, to the tail of
+ * the queue, where they take the data received next.
+ */
+void
+mpc_conn_rcv_buf_recycle(mpc_conn_t *conn, mpc_buf_t *buf)
+{
+    mpc_buf_t  *first;
+
+    for (first = STAILQ_FIRST(&conn->rcv_buf_queue);
+         first != NULL && first != buf;
+         first = STAILQ_FIRST(&conn->rcv_buf_queue))
+    {
+        ASSERT(first != conn->rcv_buf);
+
+        mpc_buf_remove(&conn->rcv_buf_queue, first);
+        mpc_buf_rewind(first);
+        mpc_buf_insert(&conn->rcv_buf_queue, first);
+    }
+}
+
+
 void
 mpc_conn_reset(mpc_conn_t *conn)
 {
@@ -285,6 +337,7 @@ mpc_conn_reset(mpc_conn_t *conn)
     conn->keepalive = 0;
     conn->connecting = 0;
     conn->connected = 0;
+    conn->fastopen = 0;
     conn->eof = 0;
     conn->done = 0;
 }
@@ -54,11 +54,17 @@ struct mpc_conn_s {
     mpc_buf_t                  *snd_buf;
     size_t                      rcv_bytes;
     size_t                      snd_bytes;
+    mpc_pool_t                 *pool;      /* kept alive in, if idle */
+    TAILQ_HEAD(, mpc_http_s)    requests;  /* in flight, oldest first */
+    uint32_t                    nrequests;
+    mpc_timer_t                 timer;     /* lingering, for the server */
+    unsigned                    ready:1;   /* takes more requests */
     unsigned                    keepalive:1;
     unsigned                    eof:1;
     unsigned                    done:1;
     unsigned                    connecting:1;
     unsigned                    connected:1;
+    unsigned                    fastopen:1; /* data in SYN not checked */
 };
 
 
@@ -73,6 +79,8 @@ int mpc_conn_recv(mpc_conn_t *conn);
 int mpc_conn_send(mpc_conn_t *conn);
 void mpc_conn_release(mpc_conn_t *conn);
 void mpc_conn_buf_rewind(mpc_conn_t *conn);
+void mpc_conn_rcv_buf_rewind(mpc_conn_t *conn);
+void mpc_conn_rcv_buf_recycle(mpc_conn_t *conn, mpc_buf_t *buf);
 void mpc_conn_reset(mpc_conn_t *conn);
 
 
@@ -34,6 +34,11 @@
 static void mpc_core_process_notify(mpc_event_loop_t *el, int fd, void *data,
     int mask);
 static int mpc_core_process_cron(mpc_event_loop_t *el, int64_t id, void *data);
+static void mpc_core_process_series(mpc_instance_t *ins, uint64_t now);
+static void mpc_core_process_warmup(mpc_instance_t *ins, uint64_t now);
+static void mpc_core_process_signals(mpc_instance_t *ins, uint64_t now);
+static void mpc_core_process_slo(mpc_instance_t *ins, uint64_t now);
+static int mpc_core_warmup_done(mpc_instance_t *ins);
 static void mpc_core_create_submit_thread(mpc_instance_t *ins);
 static void *mpc_core_submit(void *arg);
 static char *mpc_core_getline(char *buf, int size, FILE *fp);
@@ -42,6 +47,12 @@ static int mpc_core_notify(mpc_instance_t *ins);
 static void mpc_core_notify_end(mpc_instance_t *ins);
 
 
+static mpc_stat_window_t  mpc_series_window;
+static mpc_stat_window_t  mpc_series_delta;
+static mpc_stat_window_t  mpc_slo_window;
+static mpc_stat_window_t  mpc_slo_delta;
+static uint64_t           mpc_run_stop;
+
 static int start_bench = 0;
 static volatile uint32_t mpc_task_total = 0;
 static volatile uint32_t mpc_task_processed = 0;
@@ -65,6 +76,9 @@ mpc_core_create_submit_thread(mpc_instance_t *ins)
 int
 mpc_core_init(mpc_instance_t *ins)
 {
+    int            limit;
+    struct rlimit  rlim;
+
     mpc_log_init(ins->log_level, (char *)ins->log_file.data);
 
     mpc_buf_init(MPC_BUF_MAX_NFREE);
@@ -72,15 +86,36 @@ mpc_core_init(mpc_instance_t *ins)
 
     mpc_url_init(MPC_URL_MAX_NFREE);
     mpc_http_init(MPC_HTTP_MAX_NFREE);
+    mpc_pool_init(ins->host_concurrency * ins->pipeline, ins->host_idle);
 
     mpc_signal_init();
 
-    ins->el = mpc_create_event_loop(MPC_DEFAULT_EVENT_SIZE);
+    /* the fd table grows up to the limit of open files */
+    limit = MPC_MAX_INT32_VALUE;
+
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0
+        && rlim.rlim_cur != RLIM_INFINITY
+        && rlim.rlim_cur < MPC_MAX_INT32_VALUE)
+    {
+        limit = (int) rlim.rlim_cur;
+    }
+
+    if (ins->concurrency > (uint64_t) limit) {
+        mpc_log_stderr(0, "the open files limit %d is below the concurrency, "
+                          "raise it with \"ulimit -n\"", limit);
+    }
+
+    ins->el = mpc_create_event_loop(limit, (int) ins->event_batch);
     if (ins->el == NULL) {
         mpc_log_emerg(0, "create event loop failed");
         return MPC_ERROR;
     }
 
+    if (mpc_timer_init(ins->el) != MPC_OK) {
+        mpc_log_emerg(0, "initialize timers failed");
+        return MPC_ERROR;
+    }
+
 #ifdef WITH_MPC_RESOLVER
     if (mpc_resolver_init(ins->el, NULL) != MPC_OK) {
         mpc_log_emerg(0, "initialize resolver failed");
@@ -97,7 +132,9 @@ mpc_core_init(mpc_instance_t *ins)
 int
 mpc_core_deinit(mpc_instance_t *ins)
 {
+    mpc_pool_deinit(ins->el);
     mpc_http_deinit();
+    mpc_timer_deinit();
 
     mpc_buf_deinit();
     mpc_conn_deinit();
@@ -113,6 +150,10 @@ mpc_core_deinit(mpc_instance_t *ins)
         mpc_array_destroy(ins->urls);
     }
 
+    if (ins->hosts) {
+        mpc_array_destroy(ins->hosts);
+    }
+
     mpc_url_deinit();
     mpc_signal_deinit();
 
@@ -125,7 +166,8 @@ mpc_core_deinit(mpc_instance_t *ins)
 int
 mpc_core_run(mpc_instance_t *ins)
 {
-    int64_t  timer_id;
+    int64_t   timer_id;
+    uint64_t  tail;
 
     timer_id = mpc_create_time_event(ins->el, MPC_CRON_INTERVAL, 
                                      mpc_core_process_cron, (void *)ins, NULL);
@@ -148,10 +190,42 @@ mpc_core_run(mpc_instance_t *ins)
         return MPC_ERROR;
     }
 
+    if (ins->interval != 0) {
+        ins->series_fd = mpc_stat_series_create(ins->series_file.len ?
+                                           (char *)ins->series_file.data : NULL,
+                                                ins->output_format);
+        if (ins->series_fd == MPC_ERROR) {
+            return MPC_ERROR;
+        }
+    }
+
     mpc_core_create_submit_thread(ins);
 
     mpc_event_main(ins->el);
 
+    if ((ins->warmup != 0 || ins->warmup_requests != 0)
+        && ins->stat->warmup.stop == 0)
+    {
+        mpc_log_stderr(0, "run ended during warm-up, nothing was excluded");
+    }
+
+    if (ins->interval != 0) {
+        tail = ins->interval * 1000000 / MPC_SERIES_MIN_TAIL;
+
+        /* a run stopping just past a boundary leaves a near empty row */
+        if (ins->stat->stop - mpc_series_window.start
+            >= MPC_MAX(tail, MPC_CRON_INTERVAL * 1000))
+        {
+            mpc_core_process_series(ins, ins->stat->stop);
+        }
+
+        if (ins->series_fd != STDOUT_FILENO) {
+            close(ins->series_fd);
+        }
+
+        ins->series_fd = -1;
+    }
+
     if (ins->el->exit_code != MPC_OK) {
         return MPC_ERROR;
     }
@@ -190,7 +264,7 @@ mpc_core_process_notify(mpc_event_loop_t *el, int fd, void *data, int mask)
         if (n == 0) {
             //mpc_log_err(0, "pipe write end abnormal closed");
             if (ins->stat->stop == 0) {
-                ins->stat->stop = mpc_time_ms();
+                ins->stat->stop = mpc_time_monotonic_us();
             }
 
             mpc_delete_file_event(el, fd, MPC_READABLE);
@@ -202,10 +276,10 @@ mpc_core_process_notify(mpc_event_loop_t *el, int fd, void *data, int mask)
         if (ins->replay) {
             if (ins->stat->start == 0) {
                 printf("start mpc\n\n");
-                ins->stat->start = mpc_time_ms();
+                ins->stat->start = mpc_time_monotonic_us();
             }
 
-            while (ins->http_count < ins->concurrency) {
+            while (ins->http_count < ins->concurrency * ins->pipeline) {
                 mpc_url = mpc_url_task_get();
                 if (mpc_url == NULL) {
                     break;
@@ -236,9 +310,15 @@ mpc_core_process_notify(mpc_event_loop_t *el, int fd, void *data, int mask)
             }
     
         } else {
+            if (ins->host_concurrency && mpc_http_init_hosts(ins) != MPC_OK) {
+                mpc_log_emerg(0, "oom when group urls by host");
+                mpc_event_stop(el, MPC_ERROR);
+                return;
+            }
+
             start_bench = 1;
             printf("start mpc\n");
-            ins->stat->start = mpc_time_ms();
+            ins->stat->start = mpc_time_monotonic_us();
         }
     }
 }
@@ -261,7 +341,6 @@ mpc_core_put_url(void *elem, void *data)
 static int
 mpc_core_process_cron(mpc_event_loop_t *el, int64_t id, void *data)
 {
-    static int        cron_count = 0;
     mpc_instance_t   *ins = (mpc_instance_t *)data;
 
     if (ins->replay) {
@@ -275,16 +354,46 @@ mpc_core_process_cron(mpc_event_loop_t *el, int64_t id, void *data)
         }
     }
 
-    if (ins->run_time != 0) {
-        if (++cron_count >= (1000 / MPC_CRON_INTERVAL) - 1) {
-            cron_count = 0;
-            if (ins->stat->start != 0) {
-                if (((mpc_time_ms() - ins->stat->start) / 1000)
-                    >= ins->run_time)
-                {
-                    mpc_stop();
-                }
-            }
+    if (ins->stat->start != 0) {
+        mpc_core_process_warmup(ins, mpc_current_usec);
+        mpc_core_process_signals(ins, mpc_current_usec);
+
+        if (ins->slos != NULL) {
+            mpc_core_process_slo(ins, mpc_current_usec);
+        }
+
+        if (ins->sweep != NULL && mpc_core_warmup_done(ins)
+            && mpc_sweep_process(ins, mpc_current_usec) == MPC_DONE)
+        {
+            mpc_stop();
+        }
+    }
+
+    if (ins->interval != 0 && ins->stat->start != 0) {
+        if (mpc_series_window.start == 0) {
+            mpc_stat_window_open(&mpc_series_window, ins->stat,
+                                 ins->stat->start);
+        }
+
+        if (mpc_current_usec - mpc_series_window.start
+            >= ins->interval * 1000000)
+        {
+            mpc_core_process_series(ins, mpc_current_usec);
+        }
+    }
+
+    if (ins->run_time != 0 && ins->stat->start != 0) {
+
+        /*
+         * the run time counts from the end of the warm-up, a reset by
+         * SIGUSR2 does not extend it
+         */
+        if (mpc_run_stop == 0 && mpc_core_warmup_done(ins)) {
+            mpc_run_stop = ins->stat->start + ins->run_time * 1000000;
+        }
+
+        if (mpc_run_stop != 0 && mpc_current_usec >= mpc_run_stop) {
+            mpc_stop();
         }
     }
 
@@ -292,6 +401,171 @@ mpc_core_process_cron(mpc_event_loop_t *el, int64_t id, void *data)
 }
 
 
+static int
+mpc_core_warmup_done(mpc_instance_t *ins)
+{
+    return (ins->warmup == 0 && ins->warmup_requests == 0)
+           || ins->stat->warmup.stop != 0;
+}
+
+
+static void
+mpc_core_process_warmup(mpc_instance_t *ins, uint64_t now)
+{
+    mpc_stat_t  *mpc_stat = ins->stat;
+
+    if ((ins->warmup == 0 && ins->warmup_requests == 0)
+        || mpc_stat->warmup.stop != 0)
+    {
+        return;
+    }
+
+    if (ins->warmup != 0 && now < mpc_stat->start + ins->warmup * 1000000) {
+        return;
+    }
+
+    if (ins->warmup_requests != 0
+        && mpc_stat->ok + mpc_stat->failed < ins->warmup_requests)
+    {
+        return;
+    }
+
+    mpc_stat_warmup_done(mpc_stat, now);
+
+    /* the counters went back to zero, so must the windows */
+    if (mpc_series_window.start != 0) {
+        mpc_stat_window_open(&mpc_series_window, mpc_stat, now);
+    }
+
+    mpc_slo_window.start = 0;
+
+    printf("warm-up done, measuring\n");
+}
+
+
+/*
+ * Objectives are checked on the requests completed in each second after
+ * the warm-up. Once one was missed in more windows than tolerated the
+ * run can no longer pass, so it is stopped.
+ */
+static void
+mpc_core_process_slo(mpc_instance_t *ins, uint64_t now)
+{
+    uint32_t         i;
+    mpc_stat_slo_t  *slo;
+
+    if (!mpc_core_warmup_done(ins)) {
+        return;
+    }
+
+    if (mpc_slo_window.start == 0) {
+        mpc_stat_window_open(&mpc_slo_window, ins->stat, now);
+        return;
+    }
+
+    if (now < mpc_slo_window.start + MPC_STAT_SLO_WINDOW) {
+        return;
+    }
+
+    mpc_stat_window_close(&mpc_slo_window, ins->stat, now, &mpc_slo_delta);
+    mpc_stat_window_open(&mpc_slo_window, ins->stat, now);
+
+    for (i = 0; i < ins->slos->nelem; i++) {
+        slo = mpc_array_get(ins->slos, i);
+
+        if (mpc_stat_slo_check(slo, &mpc_slo_delta) == MPC_OK
+            || slo->missed <= ins->slo_tolerance
+            || ins->slo_broken)
+        {
+            continue;
+        }
+
+        ins->slo_broken = 1;
+
+        printf("objective \"%s\" broken in %u of %u windows, stopping\n",
+               slo->text, slo->missed, slo->windows);
+
+        mpc_stop();
+    }
+}
+
+
+/*
+ * SIGUSR1 writes the statistics so far, SIGUSR2 starts measuring again.
+ * Requests in flight go on in both cases.
+ */
+static void
+mpc_core_process_signals(mpc_instance_t *ins, uint64_t now)
+{
+    int              fd;
+    uint32_t         i;
+    mpc_stat_slo_t  *slo;
+
+    if (mpc_signal_snapshot) {
+        mpc_signal_snapshot = 0;
+
+        ins->stat->stop = now;
+
+        mpc_stat_print(ins->stat);
+        fflush(stdout);
+
+        if (ins->result_file.len != 0) {
+            fd = mpc_stat_result_create((char *)ins->result_file.data,
+                                        ins->output_format);
+            if (fd != MPC_ERROR
+                && mpc_stat_result_record(fd, ins, 1) == MPC_OK)
+            {
+                mpc_stat_result_close(fd);
+            }
+        }
+
+        ins->stat->stop = 0;
+    }
+
+    if (mpc_signal_reset) {
+        mpc_signal_reset = 0;
+
+        mpc_stat_reset(ins->stat, now);
+
+        if (mpc_series_window.start != 0) {
+            mpc_stat_window_open(&mpc_series_window, ins->stat, now);
+        }
+
+        mpc_slo_window.start = 0;
+
+        if (ins->sweep != NULL) {
+            mpc_sweep_reset(ins->sweep, ins->stat, now);
+        }
+
+        for (i = 0; ins->slos != NULL && i < ins->slos->nelem; i++) {
+            slo = mpc_array_get(ins->slos, i);
+            slo->windows = 0;
+            slo->missed = 0;
+            slo->worst = 0;
+        }
+
+        printf("statistics reset, measuring\n");
+        fflush(stdout);
+    }
+}
+
+
+static void
+mpc_core_process_series(mpc_instance_t *ins, uint64_t now)
+{
+    if (mpc_series_window.start == 0 || now <= mpc_series_window.start) {
+        return;
+    }
+
+    mpc_stat_window_close(&mpc_series_window, ins->stat, now,
+                          &mpc_series_delta);
+    mpc_stat_window_open(&mpc_series_window, ins->stat, now);
+
+    mpc_stat_series_record(ins->series_fd, ins->output_format,
+                           &mpc_series_delta, ins->stat->start);
+}
+
+
 static int
 mpc_core_notify(mpc_instance_t *ins)
 {
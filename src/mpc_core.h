@@ -63,6 +63,9 @@
 
 typedef struct mpc_instance_s mpc_instance_t;
 typedef struct mpc_stat_s mpc_stat_t;
+typedef struct mpc_stat_entry_s mpc_stat_entry_t;
+typedef struct mpc_sweep_s mpc_sweep_t;
+typedef struct mpc_pool_s mpc_pool_t;
 
 
 #include <mpc_signal.h>
@@ -74,13 +77,16 @@ typedef struct mpc_stat_s mpc_stat_t;
 #include <mpc_alloc.h>
 #include <mpc_util.h>
 #include <mpc_event.h>
+#include <mpc_timer.h>
 #include <mpc_net.h>
 #include <mpc_url.h>
 #include <mpc_buf.h>
 #include <mpc_connection.h>
+#include <mpc_pool.h>
 #include <mpc_conf.h>
 #include <mpc_http.h>
 #include <mpc_stat.h>
+#include <mpc_sweep.h>
 
 
 #define MPC_VERSION_NUM         0x00000009           /* aabbbccc */
@@ -89,8 +95,11 @@ typedef struct mpc_stat_s mpc_stat_t;
 #define MPC_VERSION             "mpc/" MPC_VERSION_STR
 
 #define MPC_DEFAULT_CONCURRENCY 50
-#define MPC_MAX_CONCURRENCY     50000
-#define MPC_MAX_OPENFILES       327680
+#define MPC_MAX_CONCURRENCY     1000000
+#define MPC_MAX_PIPELINE        1024
+#define MPC_DEFAULT_CONNECT_TIMEOUT  10000   /* milliseconds */
+#define MPC_DEFAULT_READ_TIMEOUT     30000
+#define MPC_MAX_OPENFILES       1048576  /* the default fs.nr_open */
 
 #define MPC_OK                  0
 #define MPC_ERROR               -1
@@ -113,6 +122,9 @@ typedef struct mpc_stat_s mpc_stat_t;
 #define MPC_TEMP_BUF_SIZE       512
 #define MPC_CONF_BUF_MAX_SIZE   8192
 #define MPC_CRON_INTERVAL       50  /* miliseconds */
+#define MPC_SERIES_MIN_TAIL     10  /* a last window under 1/10 interval */
+
+#define MPC_EXIT_SLO            2   /* a service level objective was broken */
 
 
 #define MPC_INVALID_FILE        -1
@@ -139,22 +151,61 @@ struct mpc_instance_s {
     mpc_str_t            url_file;
     mpc_str_t            result_file;
     mpc_str_t            result_mark;
+    mpc_str_t            series_file;
+    mpc_str_t            success_codes;
+    mpc_str_t            sweep_concurrency;
     mpc_str_t            log_file;
     int                  log_level;
     int                  http_method;
+    int                  output_format;
     uint64_t             concurrency;
     uint64_t             run_time;
+    uint64_t             interval;
+    uint64_t             warmup;
+    uint64_t             warmup_requests;
+    uint64_t             slo_tolerance;
+    uint64_t             sweep_step;
+    uint64_t             pipeline;
+    uint64_t             host_concurrency;
+    uint64_t             host_idle;
+    uint64_t             connect_timeout;   /* milliseconds, 0 none */
+    uint64_t             read_timeout;
+    uint64_t             timeout;
+    uint64_t             event_batch;
     mpc_flag_t           follow_location;
     mpc_flag_t           replay;
     mpc_flag_t           use_addr;
-    struct sockaddr_in   addr;
+    mpc_flag_t           precise_time;
+    mpc_flag_t           keepalive;
+    mpc_flag_t           reset_close;
+    mpc_flag_t           server_close;
+    mpc_flag_t           tcp_nodelay;
+    mpc_flag_t           tcp_quickack;
+    size_t               rcvbuf;
+    size_t               sndbuf;
+    uint64_t             tcp_user_timeout;
+    mpc_str_t            tcp_congestion;
+    mpc_flag_t           fastopen;
+    mpc_net_sockopts_t   sockopts;      /* of the above, for connections */
+    mpc_flag_t           prefer_ipv6;   /* resolve to AAAA first */
+    struct sockaddr_storage addr;
+    mpc_str_t            unix_socket;   /* instead of addr or DNS */
+    uint8_t              success[MPC_HTTP_MAX_STATUS / 8];
+    mpc_array_t         *slos;
+    mpc_array_t         *sources;     /* mpc_net_source_t */
+    mpc_stat_slo_t       sweep_target;
+    int                  sweep_target_set;
+    mpc_sweep_t         *sweep;
 
     mpc_event_loop_t    *el;
     mpc_array_t         *urls;
+    mpc_array_t         *hosts;    /* pools of the hosts of urls */
     mpc_stat_t          *stat;
     mpc_http_hdr_t       http_hdr;
     uint32_t             http_count;
     int                  self_pipe[2];
+    int                  series_fd;
+    int                  slo_broken;
 };
 
 
@@ -46,7 +46,7 @@ mpc_event_api_create(mpc_event_loop_t *el)
         return MPC_ERROR;
     }
 
-    state->events = mpc_alloc(sizeof(struct epoll_event) * el->setsize);
+    state->events = mpc_alloc(sizeof(struct epoll_event) * el->nevents);
     if (state->events == NULL) {
         mpc_free(state);
         mpc_log_err(errno, "mpc_alloc failed");
@@ -153,7 +153,7 @@ mpc_event_api_poll(mpc_event_loop_t *el, struct timeval *tvp)
     struct epoll_event     *e;
     mpc_event_api_state_t  *state = el->api_data;
 
-    retval = epoll_wait(state->epfd, state->events, el->setsize,
+    retval = epoll_wait(state->epfd, state->events, el->nevents,
                         tvp ? (tvp->tv_sec * 1000 + tvp->tv_usec / 1000) : -1);
     if (retval > 0) {
         numevents = retval;
@@ -50,9 +50,9 @@
 #endif
 
 mpc_event_loop_t *
-mpc_create_event_loop(int setsize)
+mpc_create_event_loop(int limit, int nevents)
 {
-    int                i;
+    int                i, setsize;
     mpc_event_loop_t  *el;
 
     el = (mpc_event_loop_t *)mpc_malloc(sizeof(mpc_event_loop_t));
@@ -60,6 +60,8 @@ mpc_create_event_loop(int setsize)
         return NULL;
     }
 
+    setsize = MPC_MIN(MPC_EVENT_INIT_SIZE, limit);
+
     el->events = (mpc_file_event_t *)mpc_malloc(sizeof(mpc_file_event_t)
                                                 * setsize);
     if (el->events == NULL) {
@@ -68,15 +70,18 @@ mpc_create_event_loop(int setsize)
     }
 
     el->fired = (mpc_fired_event_t *)mpc_malloc(sizeof(mpc_fired_event_t) 
-                                                * setsize);
+                                                * nevents);
     if (el->fired == NULL) {
         mpc_free(el->events);
         mpc_free(el);
         return NULL;
     }
 
-    el->last_time = time(NULL);
+    mpc_time_update();
+
     el->setsize = setsize;
+    el->limit = limit;
+    el->nevents = nevents;
     el->time_event_head = NULL;
     el->time_event_next_id = 0;
     el->stop = 0;
@@ -130,6 +135,43 @@ mpc_event_stop(mpc_event_loop_t *el, int exit)
 }
 
 
+/* Grow the table of file events to hold fd, doubling it. */
+static int
+mpc_event_grow(mpc_event_loop_t *el, int fd)
+{
+    int                i, setsize;
+    mpc_file_event_t  *events;
+
+    if (fd >= el->limit) {
+        mpc_log_err(0, "too big fd (%d) beyond limit (%d)", fd, el->limit);
+        return MPC_ERROR;
+    }
+
+    for (setsize = el->setsize; setsize <= fd; setsize *= 2) {
+        /* void */
+    }
+
+    setsize = MPC_MIN(setsize, el->limit);
+
+    events = (mpc_file_event_t *)mpc_realloc(el->events,
+                                             sizeof(mpc_file_event_t)
+                                             * setsize);
+    if (events == NULL) {
+        mpc_log_err(errno, "grow file events to %d failed", setsize);
+        return MPC_ERROR;
+    }
+
+    for (i = el->setsize; i < setsize; i++) {
+        events[i].mask = MPC_NONE;
+    }
+
+    el->events = events;
+    el->setsize = setsize;
+
+    return MPC_OK;
+}
+
+
 /* Register a file event. */
 int
 mpc_create_file_event(mpc_event_loop_t *el, int fd, int mask,
@@ -137,8 +179,7 @@ mpc_create_file_event(mpc_event_loop_t *el, int fd, int mask,
 {
     mpc_file_event_t  *fe;
 
-    if (fd >= el->setsize) {
-        mpc_log_err(0, "too big fd (%d) beyond limit (%d)", fd, el->setsize);
+    if (fd >= el->setsize && mpc_event_grow(el, fd) != MPC_OK) {
         return MPC_ERROR;
     } 
 
@@ -174,8 +215,8 @@ mpc_delete_file_event(mpc_event_loop_t *el, int fd, int mask)
 {
     mpc_file_event_t *fe;
 
+    /* never registered */
     if (fd >= el->setsize) {
-        mpc_log_warn(0, "too big fd (%d) beyond limit (%d)", fd, el->setsize);
         return;
     }
 
@@ -323,36 +364,23 @@ process_time_events(mpc_event_loop_t *el)
     int                processed = 0;
     mpc_time_event_t  *te;
     int64_t            maxid;
-    time_t             now = time(NULL);
-
-    /* If the system clock is moved to the future, and then set back to the
-     * right value, time events may be delayed in a random way. Often this
-     * means that scheduled operations will not be performed soon enough.
-     *
-     * Here we try to detect system clock skews, and force all the time
-     * events to be processed ASAP when this happens: the idea is that
-     * processing events earlier is less dangerous than delaying them
-     * indefinitely, and practice suggests it is. */
-    if (now < el->last_time) {
-        te = el->time_event_head;
-        while (te) {
-            te->when_sec = 0;
-            te = te->next;
-        }
-    }
-    el->last_time = now;
+    int64_t            now_sec, now_ms;
+
+    /* The time is cached once per loop iteration and is monotonic, so
+     * there is no clock skew to detect and no need to read it again for
+     * every time event scanned. */
+    mpc_get_time(&now_sec, &now_ms);
 
     te = el->time_event_head;
     maxid = el->time_event_next_id - 1;
     while (te) {
-        int64_t  id, now_sec, now_ms;
+        int64_t  id;
 
         /* Don't process the time event registered during this process. */
         if (te->id > maxid) { 
             te = te->next;
             continue;
         }
-        mpc_get_time(&now_sec, &now_ms);
 
         /* timeout */
         if (now_sec > te->when_sec
@@ -471,6 +499,8 @@ mpc_process_events(mpc_event_loop_t *el, int flags)
 
         numevents = mpc_event_api_poll(el, tvp);
 
+        mpc_time_update();
+
         for (j = 0; j < numevents; ++j) {
             mpc_file_event_t *fe = &el->events[el->fired[j].fd];
             int               mask = el->fired[j].mask;
@@ -485,6 +515,9 @@ mpc_process_events(mpc_event_loop_t *el, int flags)
                 rfired = 1;
                 mpc_log_debug(0, "process read event, fd: %d", fd);
                 fe->r_file_ptr(el, fd, fe->data, mask);
+
+                /* the handler may have grown, and so moved, the table */
+                fe = &el->events[fd];
             } 
 
             if (fe->mask & mask & MPC_WRITABLE) {
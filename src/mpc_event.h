@@ -42,7 +42,8 @@
 
 #define MPC_NOMORE       -1
 
-#define MPC_DEFAULT_EVENT_SIZE  65535
+#define MPC_EVENT_INIT_SIZE     1024  /* fds, the table grows to limit */
+#define MPC_DEFAULT_EVENT_BATCH 512   /* events returned by one poll */
 
 
 typedef struct mpc_event_loop_s mpc_event_loop_t;
@@ -86,9 +87,10 @@ typedef struct {
 /* state of an event base program */
 struct mpc_event_loop_s {
     int                         maxfd;
-    int                         setsize;
+    int                         setsize;  /* of events, grows on demand */
+    int                         limit;    /* the fds allowed */
+    int                         nevents;  /* of fired */
     int64_t                     time_event_next_id;
-    time_t                      last_time;
     mpc_file_event_t           *events;
     mpc_fired_event_t          *fired;
     mpc_time_event_t           *time_event_head;
@@ -105,7 +107,7 @@ struct mpc_event_loop_s {
 #endif
 
 
-mpc_event_loop_t *mpc_create_event_loop(int setsize);
+mpc_event_loop_t *mpc_create_event_loop(int limit, int nevents);
 void mpc_free_event_loop(mpc_event_loop_t *el);
 void mpc_event_stop(mpc_event_loop_t *el, int exit);
 int mpc_create_file_event(mpc_event_loop_t *el, int fd, int mask,
@@ -34,12 +34,23 @@
 #define MPC_HTTP_HEADER_DONE    -3
 
 
+/*
+ * Bench timestamps come from the time cached by the event loop unless
+ * precise timing is asked for, which reads the clock for every sample.
+ */
+#define mpc_http_time(http)                                                  \
+    ((http)->ins->precise_time ? mpc_time_update() : mpc_current_usec)
+
+
 static int              mpc_url_id;
 static uint32_t         mpc_http_nfree;
 static mpc_http_hdr_t   mpc_http_free_queue;
 static uint32_t         mpc_http_max_nfree;
 static uint32_t         mpc_http_used;
 static uint32_t         mpc_http_id;
+static uint32_t         mpc_http_source;     /* the source bound next */
+static mpc_conn_hdr_t   mpc_http_lingering;  /* waiting for the server */
+static mpc_instance_t  *mpc_http_linger_ins; /* read_timeout, reset_close */
 
 
 static int mpc_http_header_content_length(mpc_http_header_t *header, 
@@ -48,8 +59,23 @@ static int mpc_http_header_transfer_encoding(mpc_http_header_t *header,
     mpc_http_t *http, void *data);
 static int mpc_http_header_location(mpc_http_header_t *header, 
     mpc_http_t *http, void *data);
+static int mpc_http_header_connection(mpc_http_header_t *header, 
+    mpc_http_t *http, void *data);
 static int mpc_http_parse_chunked(mpc_http_t *http);
 static int mpc_http_discard_chunk(mpc_http_t *http);
+static uint64_t mpc_http_unparsed(mpc_http_t *http);
+static void mpc_http_lookup_stat(mpc_http_t *http);
+static mpc_pool_t *mpc_http_lookup_pool(mpc_url_t *mpc_url);
+static int mpc_http_reusable(mpc_http_t *http);
+static void mpc_http_retry(mpc_http_t *http);
+static mpc_url_t *mpc_http_pick_url(mpc_instance_t *ins);
+static int mpc_http_linger(mpc_http_t *http);
+static void mpc_http_process_linger_timeout(mpc_timer_t *timer);
+static void mpc_http_set_read_timeout(mpc_http_t *http);
+static void mpc_http_process_timeout(mpc_timer_t *timer);
+static void mpc_http_process_linger(mpc_event_loop_t *el, int fd, void *data,
+    int mask);
+static void mpc_http_error(mpc_http_t *http, int type);
 
 static mpc_str_t http_methods[] = {
     mpc_string("GET"),
@@ -63,6 +89,7 @@ static mpc_http_header_handler_t header_handlers[] = {
     { mpc_string("Transfer-Encoding"), mpc_http_header_transfer_encoding,
         NULL },
     { mpc_string("Location"), mpc_http_header_location, NULL },
+    { mpc_string("Connection"), mpc_http_header_connection, NULL },
     { mpc_null_string, NULL, NULL }
 };
 
@@ -87,6 +114,8 @@ int mpc_http_header_content_length(mpc_http_header_t *header,
         return MPC_ERROR;
     }
 
+    http->framed = 1;
+
     return MPC_OK;
 }
 
@@ -159,6 +188,7 @@ int mpc_http_header_transfer_encoding(mpc_http_header_t *header,
                            sizeof("chunked") - 1) == 0)
     {
         http->chunked = 1;
+        http->framed = 1;
         http->content_length_n = -1;
         return MPC_OK;
     }
@@ -169,6 +199,48 @@ int mpc_http_header_transfer_encoding(mpc_http_header_t *header,
 }
 
 
+static
+int mpc_http_header_connection(mpc_http_header_t *header, 
+    mpc_http_t *http, void *data)
+{
+    uint8_t  *p, *last, *end;
+    size_t    len;
+
+    MPC_NOTUSED(data);
+
+    /* a list of tokens such as "keep-alive, Upgrade" */
+    last = header->value.data + header->value.len;
+
+    for (p = header->value.data; p < last; p = end + 1) {
+        end = mpc_strlchr(p, last, ',');
+        if (end == NULL) {
+            end = last;
+        }
+
+        while (p < end && *p == ' ') {
+            p++;
+        }
+
+        for (len = end - p; len > 0 && p[len - 1] == ' '; len--) {
+            /* void */
+        }
+
+        if (len == sizeof("close") - 1
+            && mpc_strncasecmp(p, (uint8_t *)"close", len) == 0)
+        {
+            http->close = 1;
+
+        } else if (len == sizeof("keep-alive") - 1
+                   && mpc_strncasecmp(p, (uint8_t *)"keep-alive", len) == 0)
+        {
+            http->keep_alive = 1;
+        }
+    }
+
+    return MPC_OK;
+}
+
+
 #ifdef WITH_MPC_RESOLVER
 static void mpc_http_gethostbyname_cb(mpc_event_loop_t *el, int status,
     struct hostent *host, void *arg);
@@ -178,10 +250,14 @@ static void mpc_http_process_connect(mpc_event_loop_t *el, int fd, void *data,
     int mask);
 static void mpc_http_process_response(mpc_event_loop_t *el, int fd, void *data,
     int mask);
+static void mpc_http_parse_response(mpc_http_t *http);
+static mpc_http_t *mpc_http_parse_one_response(mpc_http_t *http);
+static void mpc_http_first_byte(mpc_http_t *http);
 static int mpc_http_parse_status_line(mpc_http_t *http);
 static int mpc_http_parse_headers(mpc_http_t *http);
 static int mpc_http_discard_body(mpc_http_t *http);
-static int mpc_http_create_request(char *addr, mpc_http_t *mpc_http);
+static int mpc_http_create_request(int family, char *addr,
+    mpc_http_t *mpc_http);
 static int mpc_http_log_headers(void *elem, void *data);
 static int mpc_http_release_url(void *elem, void *data);
 static void mpc_http_release(mpc_http_t *http);
@@ -190,7 +266,14 @@ static void mpc_http_release(mpc_http_t *http);
 void
 mpc_http_reset_bulk(mpc_http_t *http)
 {
-    mpc_conn_reset(http->conn);
+    /* a connection kept alive went back to its pool */
+    if (http->conn != NULL) {
+        mpc_conn_reset(http->conn);
+    }
+
+    /* armed again when the request is sent again */
+    mpc_timer_del(&http->timer);
+    mpc_timer_del(&http->deadline);
 
     http->buf = NULL;
     http->http_major = 0;
@@ -215,9 +298,16 @@ mpc_http_reset_bulk(mpc_http_t *http)
     http->content_length_received = 0;
     http->size = 0;
     http->length = 0;
+    http->received = 0;
+    http->header_bytes = 0;
     http->need_redirect = 0;
     http->chunked = 0;
     http->discard_chunk = 0;
+    http->framed = 0;
+    http->close = 0;
+    http->keep_alive = 0;
+    http->reused = 0;
+    http->queued = 0;
 }
 
 
@@ -228,6 +318,7 @@ mpc_http_reset(mpc_http_t *http)
 
     http->conn = NULL;
     http->url = NULL;
+    http->host = NULL;
     http->locations = NULL;
     http->ins = NULL;
 
@@ -240,6 +331,13 @@ mpc_http_reset(mpc_http_t *http)
     mpc_memzero(&http->status, sizeof(http->status));
     mpc_memzero(&http->bench, sizeof(http->bench));
 
+    http->timer.hdr = NULL;
+    http->timer.handler = mpc_http_process_timeout;
+    http->timer.data = http;
+    http->deadline.hdr = NULL;
+    http->deadline.handler = mpc_http_process_timeout;
+    http->deadline.data = http;
+
     http->headers = NULL;
     http->invalid_header = 0;
     http->header_name_start = NULL;
@@ -250,9 +348,17 @@ mpc_http_reset(mpc_http_t *http)
     http->content_length_received = 0;
     http->size = 0;
     http->length = 0;
+    http->received = 0;
+    http->header_bytes = 0;
     http->need_redirect = 0;
+    http->counted = 0;
     http->chunked = 0;
     http->discard_chunk = 0;
+    http->framed = 0;
+    http->close = 0;
+    http->keep_alive = 0;
+    http->reused = 0;
+    http->queued = 0;
 }
 
 
@@ -334,6 +440,7 @@ mpc_http_init(uint32_t max_nfree)
     mpc_http_nfree = 0;
     mpc_http_used = 0;
     TAILQ_INIT(&mpc_http_free_queue);
+    TAILQ_INIT(&mpc_http_lingering);
 }
 
 
@@ -341,6 +448,7 @@ void
 mpc_http_deinit()
 {
     mpc_http_t *http, *nhttp;
+    mpc_conn_t *conn;
 
     for (http = TAILQ_FIRST(&mpc_http_free_queue);
          http != NULL;
@@ -352,6 +460,12 @@ mpc_http_deinit()
     }
 
 //    ASSERT(mpc_http_nfree == 0);
+
+    while (!TAILQ_EMPTY(&mpc_http_lingering)) {
+        conn = TAILQ_FIRST(&mpc_http_lingering);
+        TAILQ_REMOVE(&mpc_http_lingering, conn, next);
+        mpc_conn_release(conn);
+    }
 }
 
 
@@ -361,6 +475,8 @@ mpc_http_parse_url(uint8_t *url, size_t n, mpc_url_t *mpc_url)
     uint8_t    *p, c;
     enum {
         sw_domain,
+        sw_ipv6,
+        sw_host_end,
         sw_port,
         sw_uri,
         sw_done
@@ -411,6 +527,48 @@ mpc_http_parse_url(uint8_t *url, size_t n, mpc_url_t *mpc_url)
                 break;
             }
 
+            /* an IPv6 address, the brackets are kept for "Host" */
+            if (c == '[' && mpc_url->host.len == 0) {
+                state = sw_ipv6;
+                mpc_url->host.len++;
+                break;
+            }
+
+            return MPC_ERROR;
+        case sw_ipv6:
+            if (c == ']') {
+                state = sw_host_end;
+                mpc_url->host.len++;
+                break;
+            }
+
+            if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') || c == ':'
+                 || c == '.' || (c >= '0' && c <= '9'))
+            {
+                mpc_url->host.len++;
+                break;
+            }
+
+            return MPC_ERROR;
+        case sw_host_end:
+            if (c == ':') {
+                state = sw_port;
+                p = url;
+                break;
+            }
+
+            if (c == '/') {
+                state = sw_uri;
+                mpc_url->uri.data = url - 1; /* start from '/' */
+                mpc_url->uri.len = 1;
+                break;
+            }
+
+            if (c == '\0') {
+                state = sw_done;
+                break;
+            }
+
             return MPC_ERROR;
         case sw_port:
             if (c == '/') {
@@ -447,7 +605,10 @@ mpc_http_parse_url(uint8_t *url, size_t n, mpc_url_t *mpc_url)
     }
 
     mpc_url->no_resolve = 0;
-    if (mpc_url->host.len == 0) {
+    mpc_url->url_stat = NULL;
+    mpc_url->host_stat = NULL;
+    mpc_url->pool = NULL;
+    if (mpc_url->host.len == 0 || state == sw_ipv6) {
         return MPC_ERROR;
     }
 
@@ -469,8 +630,6 @@ int
 mpc_http_process_request(mpc_instance_t *ins, mpc_url_t *mpc_url,
     mpc_http_t *mpc_http)
 {
-    printf("===== %.*s\n", (int)mpc_url->host.len, mpc_url->host.data);
-
     if (mpc_http == NULL) {
         mpc_http = mpc_http_get();
 
@@ -483,36 +642,55 @@ mpc_http_process_request(mpc_instance_t *ins, mpc_url_t *mpc_url,
         mpc_http->url = mpc_url;
     }
 
-    mpc_gethostbyname(ins->el, mpc_url->host.data, mpc_url->host.len,
-                      mpc_http_gethostbyname_cb, (void *)mpc_http);
+    /* a redirect may go to another host */
+    if (ins->hosts != NULL && mpc_http_lookup_pool(mpc_url) != NULL
+        && mpc_http->host != mpc_url->pool)
+    {
+        if (mpc_http->host != NULL) {
+            mpc_http->host->nrequests--;
+        }
 
-    return MPC_OK;
+        mpc_http->host = mpc_url->pool;
+        mpc_http->host->nrequests++;
+    }
 
     /*
-    if (ins->use_addr) {
-        if (mpc_http_create_request((char *)&ins->dst_addr.sin_addr, mpc_http)
-            != MPC_OK)
-        {
-            return MPC_ERROR;
+     * A connection kept alive to the host needs no resolving, one with
+     * room in its pipeline is preferred to an idle one.
+     */
+    if (ins->keepalive && mpc_http->conn == NULL
+        && mpc_http_lookup_pool(mpc_url) != NULL)
+    {
+        mpc_http->conn = mpc_pool_first_ready(mpc_url->pool);
+
+        if (mpc_http->conn == NULL) {
+            mpc_http->conn = mpc_pool_take(mpc_url->pool, ins->el);
         }
 
-        return MPC_OK;
+        if (mpc_http->conn != NULL) {
+            mpc_http->reused = 1;
+            return mpc_http_create_request(AF_UNSPEC, NULL, mpc_http);
+        }
     }
 
-    if (mpc_http == NULL) {
-        mpc_http = mpc_http_get();
+    if (ins->unix_socket.len) {
+        return mpc_http_create_request(AF_UNIX, NULL, mpc_http);
+    }
 
-        if (mpc_http == NULL) {
-            mpc_log_emerg(0, "oom when get http");
+    if (ins->use_addr) {
+        if (mpc_http_create_request(ins->addr.ss_family,
+                                    mpc_net_inaddr(&ins->addr), mpc_http)
+            != MPC_OK)
+        {
             return MPC_ERROR;
         }
-    
-        mpc_http->ins = ins;
-        mpc_http->url = mpc_url;
+
+        return MPC_OK;
     }
 
     if (mpc_url->no_resolve) {
-        if (mpc_http_create_request((char *)mpc_url->host.data, mpc_http)
+        if (mpc_http_create_request(AF_INET, (char *)mpc_url->host.data,
+                                    mpc_http)
             != MPC_OK)
         {
             mpc_log_err(0, "create http request \"http://%V%V\" failed",
@@ -521,15 +699,25 @@ mpc_http_process_request(mpc_instance_t *ins, mpc_url_t *mpc_url,
 
     } else {
 #ifdef WITH_MPC_RESOLVER
-        mpc_gethostbyname(ins->el, mpc_url->host.data, mpc_url->host.len,
-                          mpc_http_gethostbyname_cb, (void *)mpc_http);
+        mpc_http->bench.resolve = mpc_http_time(mpc_http);
+
+        /* an IPv6 address in brackets resolves to itself */
+        if (mpc_url->host.data[0] == '[') {
+            mpc_gethostbyname(ins->el, mpc_url->host.data + 1,
+                              mpc_url->host.len - 2, AF_INET6,
+                              mpc_http_gethostbyname_cb, (void *)mpc_http);
+
+        } else {
+            mpc_gethostbyname(ins->el, mpc_url->host.data, mpc_url->host.len,
+                              ins->prefer_ipv6 ? AF_INET6 : AF_INET,
+                              mpc_http_gethostbyname_cb, (void *)mpc_http);
+        }
 #else
         mpc_log_emerg(0, "mpc not compiled with resolver." CRLF
                          "Please recompile it with -DWITH_MPC_RESOLVER");
         exit(1);
 #endif 
     }
-    */
 
     return MPC_OK;
 }
@@ -543,46 +731,50 @@ mpc_http_gethostbyname_cb(mpc_event_loop_t *el, int status,
     mpc_http_t  *mpc_http = (mpc_http_t *)arg;
     mpc_url_t   *mpc_url = mpc_http->url;
 
-    static int count = 0;
-    count++;
-
     if (status == MPC_RESOLVER_OK) {
 #ifdef WITH_DEBUG
+        char  text[INET6_ADDRSTRLEN];
 
-        uint32_t addr = *(in_addr_t *)host->h_addr;
-        mpc_log_debug(0, "gethostbyname url(%d) \"%V\" %ud.%ud.%ud.%ud", 
+        mpc_log_debug(0, "gethostbyname url(%d) \"%V\" %s",
                       mpc_url->url_id, &mpc_url->host,
-                      addr & 0xff, (addr & 0xff00) >> 8,
-                      (addr & 0xff0000) >> 16, (addr & 0xff000000) >> 24);
+                      inet_ntop(host->h_addrtype, host->h_addr, text,
+                                sizeof(text)));
 #endif
 
-        /*
-        if (mpc_http_create_request(host->h_addr, mpc_http) != MPC_OK) {
+        mpc_stat_hist_record(&mpc_http->ins->stat->resolve,
+                             mpc_http_time(mpc_http) - mpc_http->bench.resolve);
+
+        if (mpc_http_create_request(host->h_addrtype, host->h_addr, mpc_http)
+            != MPC_OK)
+        {
             mpc_log_err(0, "create http request \"http://%V%V\" failed",
                         &mpc_url->host, &mpc_url->uri);
         }
-        */
-    } else {
-        mpc_log_err(0, "gethostbyname(%V) failed: (%d: %s)", 
-                    &mpc_url->host, status, mpc_resolver_strerror(status));
-        if (mpc_url->no_put == 0) {
-            mpc_url_put(mpc_url);
-        }
+
+        return;
     }
 
-    mpc_http_put(mpc_http);
+    mpc_log_err(0, "gethostbyname(%V) failed: (%d: %s)", 
+                &mpc_url->host, status, mpc_resolver_strerror(status));
+
+    mpc_http_error(mpc_http, MPC_STAT_ERR_RESOLVE);
 }
 #endif
 
 
 static int
-mpc_http_create_request(char *addr, mpc_http_t *mpc_http)
+mpc_http_create_request(int family, char *addr, mpc_http_t *mpc_http)
 {
     int                 flags;
+    uint32_t            n;
     int                 sockfd;
+    int                 type;
+    size_t              len;
     uint8_t            *p, *last;
     mpc_buf_t          *rcv_buf, *snd_buf;
     mpc_conn_t         *conn;
+    mpc_http_t         *head;
+    mpc_net_source_t   *source;
     mpc_url_t          *mpc_url = mpc_http->url;
     mpc_event_loop_t   *el = mpc_http->ins->el;
 
@@ -596,7 +788,9 @@ mpc_http_create_request(char *addr, mpc_http_t *mpc_http)
     rcv_buf = NULL;
     snd_buf = NULL;
     conn = NULL;
+    head = NULL;
     sockfd = -1;
+    type = MPC_STAT_ERR_OTHER;
 
     if (mpc_http->conn == NULL) {
         mpc_http->conn = mpc_conn_get();
@@ -607,6 +801,7 @@ mpc_http_create_request(char *addr, mpc_http_t *mpc_http)
     }
 
     conn = mpc_http->conn;
+    head = TAILQ_FIRST(&conn->requests);
 
     if (conn->rcv_buf == NULL) {
         conn->rcv_buf = mpc_buf_get();
@@ -620,53 +815,123 @@ mpc_http_create_request(char *addr, mpc_http_t *mpc_http)
 
     rcv_buf = conn->rcv_buf;
 
+    /* everything sent, the buffers take the request from their start */
     if (conn->snd_buf == NULL) {
-        conn->snd_buf = mpc_buf_get();
-        if (conn->snd_buf == NULL) {
+        mpc_buf_queue_rewind(&conn->snd_buf_queue);
+        conn->snd_buf = STAILQ_FIRST(&conn->snd_buf_queue);
+    }
+
+    /* a pipelined request goes after those in flight */
+    snd_buf = STAILQ_LAST(&conn->snd_buf_queue, mpc_buf_s, next);
+
+    len = http_methods[mpc_http->ins->http_method].len + mpc_url->uri.len
+          + mpc_url->host.len + sizeof(MPC_VERSION) + MPC_HTTP_REQUEST_LEN;
+
+    if (snd_buf == NULL || (size_t) (snd_buf->end - snd_buf->last) < len) {
+        snd_buf = mpc_buf_get();
+        if (snd_buf == NULL) {
             mpc_log_emerg(0, "*%ud, get buf failed", mpc_http->id);
             goto failed;
         }
     
-        mpc_buf_insert(&conn->snd_buf_queue, conn->snd_buf);
-    }
+        mpc_buf_insert(&conn->snd_buf_queue, snd_buf);
 
-    snd_buf = conn->snd_buf;
-
-    ASSERT(snd_buf->pos == snd_buf->start);
+        if (conn->snd_buf == NULL) {
+            conn->snd_buf = snd_buf;
+        }
+    }
 
     last = snd_buf->end;
-    p = mpc_slprintf(snd_buf->start, last,
+    p = mpc_slprintf(snd_buf->last, last,
                      "%V %V HTTP/1.1" CRLF
                      "Host: %V" CRLF
                      "Accept: *.*" CRLF
                      "User-Agent: %s" CRLF
-                     "Connection: close" CRLF
+                     "Connection: %s" CRLF
                      CRLF,
                      &http_methods[mpc_http->ins->http_method],
                      &mpc_url->uri,
                      &mpc_url->host,
-                     MPC_VERSION);
+                     MPC_VERSION,
+                     mpc_http->ins->keepalive ? "keep-alive" : "close");
     snd_buf->last = p;
 
-    flags = MPC_NET_NONBLOCK;
-    if (mpc_url->no_resolve) {
-        flags |= MPC_NET_NEEDATON;
-    }
+    mpc_http->bench.start = mpc_http_time(mpc_http);
 
-    mpc_http->bench.start = mpc_time_ms();
-    
-    sockfd = mpc_net_tcp_connect(addr, mpc_url->port, MPC_NET_NONBLOCK);
-    if (sockfd == MPC_ERROR) {
-        mpc_log_err(errno, "*%ud, tcp connect failed", mpc_http->id);
-        goto failed;
-    }
+    if (mpc_http->reused) {
+        /* connected already, or about to be for a pipelined request */
+        if (conn->connected) {
+            mpc_http->bench.connected = mpc_http->bench.start;
+        }
 
-    mpc_log_debug(0, "*%ud, socket fd: %d", mpc_http->id, sockfd);
-    conn->connecting = 1;
-    conn->fd = sockfd;
+        sockfd = conn->fd;
 
+    } else {
+        flags = MPC_NET_NONBLOCK;
+        if (mpc_url->no_resolve) {
+            flags |= MPC_NET_NEEDATON;
+        }
+
+        source = NULL;
+
+        /*
+         * The connections are spread over the sources in turn, those of
+         * the family of the address only.
+         */
+        if (mpc_http->ins->sources != NULL) {
+            for (n = mpc_http->ins->sources->nelem; n; n--) {
+                source = mpc_array_get(mpc_http->ins->sources,
+                                       mpc_http_source++
+                                       % mpc_http->ins->sources->nelem);
+
+                if (source->addr.ss_family == family) {
+                    break;
+                }
+
+                source = NULL;
+            }
+        }
+
+        if (mpc_http->ins->unix_socket.len) {
+            sockfd = mpc_net_unix_connect(
+                                   (char *)mpc_http->ins->unix_socket.data,
+                                   MPC_NET_NONBLOCK);
+
+        } else {
+            sockfd = mpc_net_tcp_connect(family, addr, mpc_url->port, flags,
+                                         source, &mpc_http->ins->sockopts);
+        }
+
+        if (sockfd == MPC_ERROR) {
+            type = mpc_stat_error_type(errno);
+
+            /* the listen backlog of a unix domain socket is full */
+            if (errno == EAGAIN) {
+                type = MPC_STAT_ERR_REFUSED;
+            }
+
+            mpc_log_err(errno, "*%ud, connect failed", mpc_http->id);
+            goto failed;
+        }
+
+        mpc_log_debug(0, "*%ud, socket fd: %d", mpc_http->id, sockfd);
+        conn->connecting = 1;
+        conn->fd = sockfd;
+
+        mpc_stat_inc_connections(mpc_http->ins->stat);
+
+        if (mpc_http->ins->sockopts.fastopen
+            && mpc_http->ins->unix_socket.len == 0)
+        {
+            conn->fastopen = 1;
+            mpc_stat_inc_fastopen(mpc_http->ins->stat);
+        }
+    }
+
+    /* the events of a connection go to the oldest request in flight */
     if (mpc_create_file_event(el, sockfd, MPC_WRITABLE, 
-                              mpc_http_process_connect, (void *)mpc_http)
+                              mpc_http_process_connect,
+                              (void *)(head ? head : mpc_http))
         == MPC_ERROR)
     {
         mpc_log_err(0, "*%ud, create file event failed, %p",
@@ -674,14 +939,54 @@ mpc_http_create_request(char *addr, mpc_http_t *mpc_http)
         goto failed;
     }
 
+    TAILQ_INSERT_TAIL(&conn->requests, mpc_http, next);
+    conn->nrequests++;
+    mpc_http->queued = 1;
+
+    if (mpc_http->ins->timeout) {
+        mpc_timer_add(&mpc_http->deadline, mpc_http->ins->timeout);
+    }
+
+    /* a pipelined request waits on the timer of the oldest in flight */
+    if (head == NULL) {
+        if (!mpc_http->reused) {
+            if (mpc_http->ins->connect_timeout) {
+                mpc_timer_add(&mpc_http->timer,
+                              mpc_http->ins->connect_timeout);
+            }
+
+        } else {
+            mpc_http_set_read_timeout(mpc_http);
+        }
+    }
+
+    if (mpc_http->ins->pipeline > 1) {
+        if (conn->nrequests >= mpc_http->ins->pipeline) {
+            mpc_pool_busy(conn);
+
+        } else if (!conn->ready && mpc_http_lookup_pool(mpc_url) != NULL) {
+            mpc_pool_ready(mpc_url->pool, conn);
+        }
+    }
+
     //TAILQ_INSERT_HEAD(&mpc_http->ins->http_hdr, mpc_http, next);
-    mpc_http->ins->http_count++;
+
+    /* a redirect goes on with the same http */
+    if (!mpc_http->counted) {
+        mpc_http->counted = 1;
+        mpc_http->ins->http_count++;
+    }
 
     return MPC_OK;
 
 failed:
 
-    mpc_http_release(mpc_http);
+    /* the connection goes on with the requests in flight on it */
+    if (head != NULL) {
+        mpc_http->conn = NULL;
+    }
+
+    mpc_http_error(mpc_http, type);
 
     return MPC_ERROR;
 }
@@ -694,6 +999,18 @@ mpc_http_release(mpc_http_t *http)
 
     mpc_log_debug(0, "*%ud, mpc_http_release", http->id);
 
+    if (http->counted) {
+        http->ins->http_count--;
+    }
+
+    mpc_timer_del(&http->timer);
+    mpc_timer_del(&http->deadline);
+
+    if (http->host != NULL) {
+        http->host->nrequests--;
+        http->host = NULL;
+    }
+
     if (http->url != NULL) {
         if (http->url->no_put == 0) {
             mpc_url_put(http->url);
@@ -701,105 +1018,424 @@ mpc_http_release(mpc_http_t *http)
         }
     }
 
-    if (http->conn != NULL) {
-        mpc_conn_release(http->conn);
-        http->conn = NULL;
-    }
+    if (http->conn != NULL) {
+        mpc_conn_release(http->conn);
+        http->conn = NULL;
+    }
+
+    if (http->headers != NULL) {
+        mpc_array_destroy(http->headers);
+        http->headers = NULL;
+    }
+
+    if (http->locations != NULL) {
+        mpc_array_each(http->locations, mpc_http_release_url, http);
+        mpc_array_destroy(http->locations);
+    }
+
+    mpc_http_put(http);
+}
+
+
+static void
+mpc_http_process_connect(mpc_event_loop_t *el, int fd, void *data, int mask)
+{
+    mpc_http_t  *http = (mpc_http_t *)data;
+    mpc_conn_t  *conn = http->conn;
+    mpc_http_t  *pipelined;
+    int          n, err;
+
+    mpc_log_debug(0, "*%ud, mpc_http_process_connect: %p, fd: %d, conn->fd: %d",
+                  http->id, http, fd, conn->fd);
+
+    if (http->bench.connected == 0) {
+        http->bench.connected = mpc_http_time(http);
+    
+        mpc_log_debug(0, "*%ud, connecting time: %uLus",
+                      http->id, 
+                      http->bench.connected - http->bench.start);
+
+        mpc_stat_hist_record(&http->ins->stat->connect,
+                             http->bench.connected - http->bench.start);
+
+        /* the requests pipelined while connecting */
+        TAILQ_FOREACH(pipelined, &conn->requests, next) {
+            if (pipelined->bench.connected == 0) {
+                pipelined->bench.connected = http->bench.connected;
+            }
+        }
+    }
+
+    conn->connected = 1;
+    conn->connecting = 0;
+
+    n = mpc_conn_send(conn);
+
+    if (n < 0) {
+        err = errno;
+        mpc_delete_file_event(el, fd, MPC_WRITABLE);
+
+        if (http->reused && http->received == 0) {
+            mpc_http_retry(http);
+            return;
+        }
+
+        mpc_log_err(err, "*%ud, send request faile, %p",
+                    http->id, http);
+        mpc_http_error(http, mpc_stat_error_type(err));
+        return;
+    }
+
+    mpc_log_debug(0, "*%ud, send request bytes (%d:%d), %p", 
+                  http->id, n, conn->snd_bytes, http);
+
+    mpc_http_set_read_timeout(http);
+
+    mpc_stat_inc_request_bytes(http->ins->stat, n);
+
+    if (conn->done) {
+        conn->done = 0;
+        mpc_log_debug(0, "*%ud, send request over, prepare process response"
+                          ", %p", 
+                          http->id, http);
+        mpc_delete_file_event(el, fd, MPC_WRITABLE);
+        if (mpc_create_file_event(el, fd, MPC_READABLE,
+                          mpc_http_process_response, (void *)http) == MPC_ERROR)
+        {
+            mpc_http_error(http, MPC_STAT_ERR_OTHER);
+            return;
+        }
+    }
+}
+
+
+static uint64_t
+mpc_http_unparsed(mpc_http_t *http)
+{
+    uint64_t    n;
+    mpc_buf_t  *buf;
+
+    n = 0;
+
+    for (buf = http->buf; buf != NULL; buf = STAILQ_NEXT(buf, next)) {
+        n += buf->last - buf->pos;
+    }
+
+    return n;
+}
+
+
+static void
+mpc_http_lookup_stat(mpc_http_t *http)
+{
+    mpc_url_t   *mpc_url = http->url;
+    uint8_t      name[MPC_URL_BUF_SIZE], *last;
+    mpc_stat_t  *mpc_stat = http->ins->stat;
+
+    /* look the entries up once, the url is requested again and again */
+
+    if (mpc_url->host_stat == NULL) {
+        last = mpc_snprintf(name, sizeof(name), "%V:%d",
+                            &mpc_url->host, mpc_url->port);
+        mpc_url->host_stat = mpc_stat_table_get(mpc_stat->hosts, name,
+                                                last - name);
+    }
+
+    if (mpc_url->url_stat == NULL) {
+        last = mpc_snprintf(name, sizeof(name), "http://%V:%d%V",
+                            &mpc_url->host, mpc_url->port, &mpc_url->uri);
+        mpc_url->url_stat = mpc_stat_table_get(mpc_stat->urls, name,
+                                               last - name);
+    }
+}
+
+
+static mpc_pool_t *
+mpc_http_lookup_pool(mpc_url_t *mpc_url)
+{
+    uint8_t     name[MPC_URL_BUF_SIZE], *last;
+
+    if (mpc_url->pool == NULL) {
+        last = mpc_snprintf(name, sizeof(name), "%V:%d",
+                            &mpc_url->host, mpc_url->port);
+        mpc_url->pool = mpc_pool_get(name, last - name);
+    }
+
+    return mpc_url->pool;
+}
+
+
+/*
+ * A connection goes on after a response whose end was known from its
+ * framing, not from the server closing it, unless the server asked to
+ * close it.
+ */
+static int
+mpc_http_reusable(mpc_http_t *http)
+{
+    if (!http->ins->keepalive || mpc_http_lookup_pool(http->url) == NULL) {
+        return 0;
+    }
+
+    if (!http->framed && http->ins->http_method != MPC_HTTP_METHOD_HEAD
+        && http->status.code != 204 && http->status.code != 304
+        && http->status.code / 100 != 1)
+    {
+        return 0;
+    }
+
+    if (http->status.http_version >= 1001 ? http->close : !http->keep_alive) {
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/*
+ * The connection of http is closed: the requests in flight after it were
+ * not answered, send them again on other connections.
+ */
+static void
+mpc_http_requeue(mpc_http_t *http)
+{
+    mpc_conn_t  *conn = http->conn;
+    mpc_http_t  *pipelined;
+
+    mpc_pool_busy(conn);
+
+    if (conn->fd != -1) {
+        mpc_delete_file_event(http->ins->el, conn->fd,
+                              MPC_READABLE | MPC_WRITABLE);
+    }
+
+    if (http->queued) {
+        TAILQ_REMOVE(&conn->requests, http, next);
+        conn->nrequests--;
+        http->queued = 0;
+    }
+
+    while (!TAILQ_EMPTY(&conn->requests)) {
+        pipelined = TAILQ_FIRST(&conn->requests);
+
+        TAILQ_REMOVE(&conn->requests, pipelined, next);
+        conn->nrequests--;
+
+        mpc_log_debug(0, "*%ud, pipelined request not answered, retry, %p",
+                      pipelined->id, pipelined);
+
+        pipelined->conn = NULL;
+        mpc_http_reset_bulk(pipelined);
+
+        mpc_http_process_request(pipelined->ins, pipelined->url, pipelined);
+    }
+}
+
+
+/*
+ * The server closed a kept connection before it answered, as it may at
+ * any time; send the request again on another connection.
+ */
+static void
+mpc_http_retry(mpc_http_t *http)
+{
+    mpc_log_debug(0, "*%ud, kept connection closed, retry, %p",
+                  http->id, http);
+
+    mpc_http_requeue(http);
+    mpc_conn_release(http->conn);
+    http->conn = NULL;
+
+    mpc_http_reset_bulk(http);
+
+    mpc_http_process_request(http->ins, http->url, http);
+}
+
+
+/*
+ * Keep the connection of a response that carried "Connection: close" open
+ * until the server closes it.
+ */
+static int
+mpc_http_linger(mpc_http_t *http)
+{
+    mpc_conn_t  *conn = http->conn;
+
+    if (mpc_create_file_event(http->ins->el, conn->fd, MPC_READABLE,
+                              mpc_http_process_linger, (void *)conn)
+        == MPC_ERROR)
+    {
+        return MPC_ERROR;
+    }
+
+    TAILQ_INSERT_TAIL(&mpc_http_lingering, conn, next);
+    http->conn = NULL;
+
+    /* a server that never closes costs a socket for the read timeout */
+    conn->timer.handler = mpc_http_process_linger_timeout;
+    conn->timer.data = conn;
+
+    mpc_timer_add(&conn->timer, http->ins->read_timeout
+                                ? http->ins->read_timeout
+                                : MPC_DEFAULT_READ_TIMEOUT);
+
+    mpc_http_linger_ins = http->ins;
+
+    return MPC_OK;
+}
+
+
+static void
+mpc_http_process_linger(mpc_event_loop_t *el, int fd, void *data, int mask)
+{
+    mpc_conn_t  *conn = (mpc_conn_t *)data;
+    char         buf[MPC_TEMP_BUF_SIZE];
+    int          n;
+
+    n = read(fd, buf, sizeof(buf));
+
+    if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EINTR))) {
+        return;
+    }
+
+    mpc_log_debug(0, "server closed connection, fd: %d", fd);
+
+    mpc_delete_file_event(el, fd, MPC_READABLE);
+    TAILQ_REMOVE(&mpc_http_lingering, conn, next);
+    mpc_conn_release(conn);
+}
+
+
+static void
+mpc_http_process_linger_timeout(mpc_timer_t *timer)
+{
+    mpc_conn_t      *conn = (mpc_conn_t *)timer->data;
+    mpc_instance_t  *ins = mpc_http_linger_ins;
+
+    mpc_log_err(0, "server did not close connection, fd: %d", conn->fd);
+
+    if (ins->reset_close) {
+        mpc_net_tcp_reset(conn->fd);
+    }
+
+    mpc_delete_file_event(ins->el, conn->fd, MPC_READABLE);
+    TAILQ_REMOVE(&mpc_http_lingering, conn, next);
+    mpc_conn_release(conn);
+}
+
+
+/* the connection made progress, or a request is the oldest in flight */
+static void
+mpc_http_set_read_timeout(mpc_http_t *http)
+{
+    if (http->ins->read_timeout) {
+        mpc_timer_add(&http->timer, http->ins->read_timeout);
+
+    } else {
+        mpc_timer_del(&http->timer);
+    }
+}
+
+
+static void
+mpc_http_process_timeout(mpc_timer_t *timer)
+{
+    mpc_http_t  *http = (mpc_http_t *)timer->data;
+
+    if (timer == &http->deadline) {
+        mpc_log_err(0, "*%ud, request timed out, %p", http->id, http);
 
-    if (http->headers != NULL) {
-        mpc_array_destroy(http->headers);
-        http->headers = NULL;
-    }
+    } else if (http->conn != NULL && !http->conn->connected) {
+        mpc_log_err(0, "*%ud, connect timed out, %p", http->id, http);
 
-    if (http->locations != NULL) {
-        mpc_array_each(http->locations, mpc_http_release_url, http);
-        mpc_array_destroy(http->locations);
+    } else {
+        mpc_log_err(0, "*%ud, read timed out, %p", http->id, http);
     }
 
-    mpc_http_put(http);
+    mpc_http_error(http, MPC_STAT_ERR_TIMEDOUT);
 }
 
 
+/*
+ * Every transaction that does not end with a response goes through here,
+ * so that it is counted as failed exactly once, with its cause.
+ */
 static void
-mpc_http_process_connect(mpc_event_loop_t *el, int fd, void *data, int mask)
+mpc_http_error(mpc_http_t *http, int type)
 {
-    mpc_http_t  *http = (mpc_http_t *)data;
-    mpc_conn_t  *conn = http->conn;
-    int          n;
+    mpc_instance_t  *ins = http->ins;
 
-    mpc_log_debug(0, "*%ud, mpc_http_process_connect: %p, fd: %d, conn->fd: %d",
-                  http->id, http, fd, conn->fd);
+    if (http->conn != NULL) {
+        mpc_http_requeue(http);
+    }
 
-    if (http->bench.connected == 0) {
-        http->bench.connected = mpc_time_ms();
-    
-        mpc_log_debug(0, "*%ud, connecting time: %uLms",
-                      http->id, 
-                      http->bench.connected - http->bench.start);
+    mpc_stat_inc_failed(ins->stat);
+    mpc_stat_inc_error(ins->stat, type);
+
+    /* the response ended before its headers did */
+    if (http->header_bytes == 0) {
+        mpc_stat_inc_header_bytes(ins->stat, http->received);
     }
 
-    conn->connected = 1;
-    conn->connecting = 0;
-    http->phase = MPC_HTTP_SEND_REQUEST;
+    if (http->url != NULL) {
+        mpc_http_lookup_stat(http);
+        mpc_stat_entry_inc_failed(http->url->host_stat);
+        mpc_stat_entry_inc_failed(http->url->url_stat);
+    }
 
-    n = mpc_conn_send(conn);
+    mpc_http_release(http);
 
-    if (n < 0) {
-        mpc_log_err(errno, "*%ud, send request faile, %p",
-                    http->id, http);
-        mpc_delete_file_event(el, fd, MPC_WRITABLE);
-        mpc_http_release(http);
-        return;
+    if (ins->urls != NULL) {
+        mpc_http_create_missing_requests(ins);
     }
+}
 
-    mpc_log_debug(0, "*%ud, send request bytes (%d:%d), %p", 
-                  http->id, n, conn->snd_bytes, http);
 
-    if (conn->done) {
-        conn->done = 0;
-        mpc_log_debug(0, "*%ud, send request over, prepare process response"
-                          ", %p", 
-                          http->id, http);
-        mpc_delete_file_event(el, fd, MPC_WRITABLE);
-        if (mpc_create_file_event(el, fd, MPC_READABLE,
-                          mpc_http_process_response, (void *)http) == MPC_ERROR)
-        {
-            mpc_http_release(http);
-            return;
-        }
+static void
+mpc_http_first_byte(mpc_http_t *http)
+{
+    if (http->bench.first_packet_reach != 0) {
+        return;
     }
+
+    http->bench.first_packet_reach = mpc_http_time(http);
+    mpc_log_debug(0, "*%ud, first packet: %uLus, %p",
+                  http->id, 
+                  http->bench.first_packet_reach - http->bench.connected,
+                  http);
+
+    mpc_stat_hist_record(&http->ins->stat->first_byte,
+                         http->bench.first_packet_reach
+                         - http->bench.connected);
 }
 
 
 static void
 mpc_http_process_response(mpc_event_loop_t *el, int fd, void *data, int mask)
 {
-    mpc_http_t   *http = (mpc_http_t *)data;
-    mpc_conn_t   *conn = http->conn;
-    mpc_url_t    *mpc_url = http->url;
-    mpc_url_t    *temp_url;
-    mpc_url_t   **url_index;
-    int           n;
-    int           rc;
-    uint64_t      elapsed;
+    mpc_http_t      *http = (mpc_http_t *)data;
+    mpc_conn_t      *conn = http->conn;
+    int              n;
+    int              err;
 
     mpc_log_debug(0, "*%ud, mpc_http_process_response: %p, fd: %d, conn->fd: %d",
                   http->id, http, fd, conn->fd);
 
-    if (http->bench.first_packet_reach == 0) {
-        http->bench.first_packet_reach = mpc_time_ms();
-        mpc_log_debug(0, "*%ud, first packet: %uLms, %p",
-                      http->id, 
-                      http->bench.first_packet_reach - http->bench.connected,
-                      http);
-    }
+    mpc_http_first_byte(http);
 
     n = mpc_conn_recv(conn);
     if (n < 0) {
-        mpc_log_err(errno, "*%ud, recv response failed, %p",
-                    http->id, http);
+        err = errno;
         mpc_delete_file_event(el, fd, MPC_READABLE);
-        mpc_http_release(http);
+
+        if (http->reused && http->received == 0) {
+            mpc_http_retry(http);
+            return;
+        }
+
+        mpc_log_err(err, "*%ud, recv response failed, %p",
+                    http->id, http);
+        mpc_http_error(http, mpc_stat_error_type(err));
         return;
     }
 
@@ -807,23 +1443,79 @@ mpc_http_process_response(mpc_event_loop_t *el, int fd, void *data, int mask)
                   http->id, n, conn->rcv_bytes, http);
 
     if (n == 0) {
+        if (conn->eof && http->reused && http->received == 0) {
+            mpc_delete_file_event(el, fd, MPC_READABLE);
+            mpc_http_retry(http);
+            return;
+        }
+
         if (conn->eof) {
             mpc_log_err(0, "*%ud, connection closed by server prematurely"
                            ", %p", 
                            http->id, http);
             mpc_delete_file_event(el, fd, MPC_READABLE);
-            mpc_http_release(http);
+            mpc_http_error(http, MPC_STAT_ERR_CLOSED);
         }
         return;
     }
 
+    mpc_http_set_read_timeout(http);
+
+    if (http->ins->sockopts.quickack) {
+        mpc_net_tcp_quickack(fd);
+    }
+
+    /* the handshake is over once the server answered */
+    if (conn->fastopen) {
+        conn->fastopen = 0;
+
+        if (mpc_net_tcp_syn_data(fd) == 1) {
+            mpc_stat_inc_syn_data(http->ins->stat);
+        }
+    }
+
     /* record statistics */
     mpc_stat_inc_bytes(http->ins->stat, n);
+    http->received += n;
+
+    if (http->header_bytes != 0) {
+        mpc_stat_inc_body_bytes(http->ins->stat, n);
+    }
 
     if (http->buf == NULL) {
         http->buf = STAILQ_FIRST(&http->conn->rcv_buf_queue);
     }
 
+    mpc_http_parse_response(http);
+}
+
+
+static void
+mpc_http_parse_response(mpc_http_t *http)
+{
+    /* the responses of the pipelined requests that came together */
+    do {
+        http = mpc_http_parse_one_response(http);
+    } while (http != NULL);
+}
+
+
+/* returns the next request when its response is buffered already */
+static mpc_http_t *
+mpc_http_parse_one_response(mpc_http_t *http)
+{
+    mpc_conn_t        *conn = http->conn;
+    mpc_url_t         *mpc_url = http->url;
+    mpc_event_loop_t  *el = http->ins->el;
+    int                fd = conn->fd;
+    mpc_instance_t    *ins;
+    mpc_http_t        *next;
+    mpc_url_t         *temp_url;
+    mpc_url_t        **url_index;
+    int                rc;
+    int                ok;
+    uint64_t           elapsed, unparsed;
+
     switch (http->phase) {
     case MPC_HTTP_SEND_REQUEST:
         http->phase = MPC_HTTP_PARSE_STATUS_LINE;
@@ -846,11 +1538,11 @@ parse_status_line:
         mpc_log_err(0, "*%ud, parse status failed, %p",
                     http->id, http);
         mpc_delete_file_event(el, fd, MPC_READABLE);
-        mpc_http_release(http);
-        return;
+        mpc_http_error(http, MPC_STAT_ERR_PROTOCOL);
+        return NULL;
 
     } else if (rc == MPC_AGAIN) {
-        return;
+        return NULL;
     }
 
     http->phase = MPC_HTTP_PARSE_HEADERS;
@@ -865,13 +1557,19 @@ parse_headers:
         mpc_log_debug(0, "*%ud, parse header failed, %p",
                       http->id, http);
         mpc_delete_file_event(el, fd, MPC_READABLE);
-        mpc_http_release(http);
-        return;
+        mpc_http_error(http, MPC_STAT_ERR_PROTOCOL);
+        return NULL;
 
     } else if (rc == MPC_AGAIN) {
-        return;
+        return NULL;
     }
 
+    /* what was received beyond the headers already is body */
+    http->header_bytes = http->received - mpc_http_unparsed(http);
+    mpc_stat_inc_header_bytes(http->ins->stat, http->header_bytes);
+    mpc_stat_inc_body_bytes(http->ins->stat,
+                            http->received - http->header_bytes);
+
 #ifdef WITH_DEBUG
     mpc_array_each(http->headers, mpc_http_log_headers, (void *)http);
 #endif
@@ -910,13 +1608,13 @@ parse_body:
 
                 } else if (rc == MPC_AGAIN) {
                     http->discard_chunk = 1;
-                    return;
+                    return NULL;
 
                 } else {
                     mpc_log_err(0, "*%ud, discard chunk failed", http->id);
                     mpc_delete_file_event(el, fd, MPC_READABLE);
-                    mpc_http_release(http);
-                    return;
+                    mpc_http_error(http, MPC_STAT_ERR_PROTOCOL);
+                    return NULL;
                 }
 
                 continue;
@@ -932,14 +1630,14 @@ parse_body:
             }
 
             if (rc == MPC_AGAIN) {
-                return;
+                return NULL;
             }
 
             /* invalid response */
             mpc_log_err(0, "*%ud, invalid chunked response", http->id);
             mpc_delete_file_event(el, fd, MPC_READABLE);
-            mpc_http_release(http);
-            return;
+            mpc_http_error(http, MPC_STAT_ERR_PROTOCOL);
+            return NULL;
         }
 
     } else {
@@ -950,8 +1648,8 @@ parse_body:
             mpc_log_err(0, "*%ud, parse body failed, %p",
                         http->id, http);
             mpc_delete_file_event(el, fd, MPC_READABLE);
-            mpc_http_release(http);
-            return;
+            mpc_http_error(http, MPC_STAT_ERR_PROTOCOL);
+            return NULL;
     
         } else if (rc == MPC_AGAIN) {
             if (conn->eof) {
@@ -959,17 +1657,19 @@ parse_body:
                              ", %p",
                              http->id, http);
                 mpc_delete_file_event(el, fd, MPC_READABLE);
-                mpc_http_release(http);
+                mpc_http_error(http, MPC_STAT_ERR_CLOSED);
+                return NULL;
             }
     
-            mpc_conn_buf_rewind(http->conn);
-            return;
+            mpc_conn_rcv_buf_rewind(http->conn);
+            http->buf = NULL;
+            return NULL;
         }
     }
 
 done:
 
-    http->bench.end = mpc_time_ms();
+    http->bench.end = mpc_http_time(http);
 
     if (conn->eof) {
         mpc_log_debug(0, "*%ud, request over server close connection,"
@@ -981,30 +1681,106 @@ done:
                          http->id, http);
     }
 
-    mpc_delete_file_event(el, fd, MPC_READABLE);
-    if (close(http->conn->fd) < 0) {
-        mpc_log_err(errno, "*%ud, close fd (%d) failed, %p",
-                    http->id, http->conn->fd, http);
+    if (http->reused) {
+        mpc_stat_inc_reused(http->ins->stat);
+    }
+
+    /* the response is in, the next request in flight reads on */
+    TAILQ_REMOVE(&conn->requests, http, next);
+    conn->nrequests--;
+    http->queued = 0;
+
+    next = TAILQ_FIRST(&conn->requests);
+    unparsed = mpc_http_unparsed(http);
+
+    if (next != NULL && mpc_http_reusable(http)
+        && mpc_create_file_event(el, fd, MPC_READABLE,
+                                 mpc_http_process_response, (void *)next)
+           == MPC_OK)
+    {
+        mpc_http_set_read_timeout(next);
+
+        /* what was received beyond the response is the next one's */
+        http->received -= unparsed;
+        http->ins->stat->body_bytes -= unparsed;
+        next->received = unparsed;
+
+        if (unparsed == 0) {
+            mpc_conn_rcv_buf_rewind(conn);
+            next->buf = NULL;
+
+        } else {
+            mpc_conn_rcv_buf_recycle(conn, http->buf);
+            next->buf = http->buf;
+        }
+
+        if (!conn->ready && !conn->eof
+            && conn->nrequests < http->ins->pipeline)
+        {
+            mpc_pool_ready(mpc_url->pool, conn);
+        }
+
+        http->conn = NULL;
+
+    } else if (next == NULL && mpc_http_reusable(http) && !conn->eof
+               && unparsed == 0)
+    {
+        mpc_delete_file_event(el, fd, MPC_READABLE);
+        mpc_pool_busy(conn);
+
+        if (mpc_pool_keep(mpc_url->pool, conn, el) == MPC_OK) {
+            http->conn = NULL;
+        }
+    }
+
+    if (http->conn != NULL) {
+        mpc_http_requeue(http);
+        next = NULL;
+    }
+
+    /* the server closes first, the TIME_WAIT is left on its side */
+    if (http->conn != NULL && http->ins->server_close && !conn->eof
+        && (http->status.http_version >= 1001 ? http->close
+                                              : !http->keep_alive))
+    {
+        mpc_http_linger(http);
+    }
+
+    if (http->conn != NULL) {
+        if (http->ins->reset_close && !conn->eof) {
+            mpc_net_tcp_reset(http->conn->fd);
+        }
+
+        if (close(http->conn->fd) < 0) {
+            mpc_log_err(errno, "*%ud, close fd (%d) failed, %p",
+                        http->id, http->conn->fd, http);
+        }
+        http->conn->fd = -1;
     }
-    http->conn->fd = -1;
 
     /* record statistics */
     elapsed = http->bench.end - http->bench.start;
     mpc_stat_set_longest(http->ins->stat, elapsed);
     mpc_stat_set_shortest(http->ins->stat, elapsed);
     mpc_stat_inc_total_time(http->ins->stat, elapsed);
+    mpc_stat_hist_record(&http->ins->stat->latency, elapsed);
+    mpc_stat_hist_record(&http->ins->stat->transfer,
+                         http->bench.end - http->bench.first_packet_reach);
 
-    if (http->status.code != 200 && http->status.code != 302
-        && http->status.code != 404)
-    {
-        mpc_stat_inc_failed(http->ins->stat);
-    } else {
+    ok = mpc_http_status_test(http->ins->success, http->status.code);
+
+    mpc_stat_inc_status(http->ins->stat, http->status.code);
+
+    if (ok) {
         mpc_stat_inc_ok(http->ins->stat);
+    } else {
+        mpc_stat_inc_failed(http->ins->stat);
+        mpc_stat_inc_error(http->ins->stat, MPC_STAT_ERR_STATUS);
     }
 
-    if (http->ins->urls != NULL) {
-        mpc_http_create_missing_requests(http->ins);
-    }
+    mpc_http_lookup_stat(http);
+    mpc_stat_entry_record(mpc_url->host_stat, ok, http->received, elapsed);
+    mpc_stat_entry_record(mpc_url->url_stat, ok, http->received, elapsed);
 
     if (http->ins->follow_location && http->need_redirect) {
         url_index = (mpc_url_t **)mpc_array_top(http->locations);
@@ -1020,14 +1796,24 @@ done:
                         http->id, &mpc_url->host, &mpc_url->uri, http);
         }
 
-        return;
+    } else {
+        //TAILQ_REMOVE(&http->ins->http_hdr, http, next);
+        ins = http->ins;
+
+        mpc_http_release(http);
+
+        if (ins->urls != NULL) {
+            mpc_http_create_missing_requests(ins);
+        }
     }
 
-    //TAILQ_REMOVE(&http->ins->http_hdr, http, next);
-    http->ins->http_count--;
+    /* the next response came with this one */
+    if (next != NULL && unparsed != 0) {
+        mpc_http_first_byte(next);
+        return next;
+    }
 
-    mpc_http_release(http);
-    return;
+    return NULL;
 }
 
 
@@ -1609,22 +2395,30 @@ static int
 mpc_http_discard_body(mpc_http_t *http)
 {
     mpc_buf_t *buf = http->buf;
+    size_t     n;
+    int        framed;
+
+    framed = http->framed || http->status.code == 204
+             || http->status.code == 304;
 
     while (buf) {
-        /*
-        while (buf->pos < buf->last) {
-            buf->pos++;
-            http->content_length_received++;
+        n = buf->last - buf->pos;
+
+        /* a pipelined response may follow in the buffer */
+        if (framed) {
+            n = MPC_MIN(n, (size_t) (http->content_length_n
+                                     - http->content_length_received));
         }
-        */
 
-        http->content_length_received += buf->last - buf->pos;
-        buf->pos = buf->last;
+        http->content_length_received += n;
+        buf->pos += n;
 
-        if (buf->pos == buf->last) {
-            buf = STAILQ_NEXT(buf, next);
-            http->buf = buf;
+        if (buf->pos != buf->last) {
+            break;
         }
+
+        buf = STAILQ_NEXT(buf, next);
+        http->buf = buf;
     }
 
     mpc_log_debug(0, "*%ud, http rcv body bytes(%d), %p",
@@ -1898,6 +2692,7 @@ data:
     return rc;
 
 done:
+    buf->pos++;     /* the last LF */
     return MPC_DONE;
 
 invalid:
@@ -1905,6 +2700,100 @@ invalid:
 }
 
 
+/*
+ * Group the urls by their host:port, for the requests to be spread over
+ * the hosts with room for more.
+ */
+int
+mpc_http_init_hosts(mpc_instance_t *ins)
+{
+    uint32_t      i;
+    mpc_url_t    *mpc_url, **mpc_url_p;
+    mpc_pool_t   *pool, **pool_p;
+
+    ins->hosts = mpc_array_create(16, sizeof(mpc_pool_t *));
+    if (ins->hosts == NULL) {
+        return MPC_ERROR;
+    }
+
+    for (i = 0; i < ins->urls->nelem; i++) {
+        mpc_url = *(mpc_url_t **) mpc_array_get(ins->urls, i);
+
+        pool = mpc_http_lookup_pool(mpc_url);
+        if (pool == NULL) {
+            return MPC_ERROR;
+        }
+
+        if (pool->urls == NULL) {
+            pool->urls = mpc_array_create(16, sizeof(mpc_url_t *));
+            if (pool->urls == NULL) {
+                return MPC_ERROR;
+            }
+
+            pool_p = mpc_array_push(ins->hosts);
+            if (pool_p == NULL) {
+                return MPC_ERROR;
+            }
+
+            *pool_p = pool;
+        }
+
+        mpc_url_p = mpc_array_push(pool->urls);
+        if (mpc_url_p == NULL) {
+            return MPC_ERROR;
+        }
+
+        *mpc_url_p = mpc_url;
+    }
+
+    return MPC_OK;
+}
+
+
+/*
+ * Pick a url at random among those whose host has room, each as likely
+ * as in a pick from all the urls.
+ */
+static mpc_url_t *
+mpc_http_pick_url(mpc_instance_t *ins)
+{
+    uint32_t      i, total;
+    mpc_pool_t   *pool;
+
+    total = 0;
+
+    for (i = 0; i < ins->hosts->nelem; i++) {
+        pool = *(mpc_pool_t **) mpc_array_get(ins->hosts, i);
+
+        if (!mpc_pool_full(pool)) {
+            total += pool->urls->nelem;
+        }
+    }
+
+    if (total == 0) {
+        return NULL;
+    }
+
+    total = random() % total;
+
+    for (i = 0; i < ins->hosts->nelem; i++) {
+        pool = *(mpc_pool_t **) mpc_array_get(ins->hosts, i);
+
+        if (mpc_pool_full(pool)) {
+            continue;
+        }
+
+        if (total < pool->urls->nelem) {
+            return *(mpc_url_t **) mpc_array_get(pool->urls, total);
+        }
+
+        total -= pool->urls->nelem;
+    }
+
+    return NULL;
+}
+
+
 void
 mpc_http_create_missing_requests(mpc_instance_t *ins)
 {
@@ -1914,24 +2803,41 @@ mpc_http_create_missing_requests(mpc_instance_t *ins)
     int64_t       idx;
     int           n;
     uint32_t      concurrency;
+    static int    creating;
+
+    /* a request failing at once must not start the next one recursively */
+    if (creating) {
+        return;
+    }
 
     concurrency = mpc_http_get_used();
-    
-    if (concurrency >= (uint32_t) (ins->concurrency * 1.0)) {
+
+    /* the requests in flight are capped at concurrency x pipeline depth */
+    if (concurrency >= (uint32_t) (ins->concurrency * ins->pipeline)) {
         return;
     }
 
-    n = (uint32_t)(ins->concurrency * 1.0) - concurrency;
+    n = (uint32_t)(ins->concurrency * ins->pipeline) - concurrency;
 
     ASSERT(n > 0);
 
     while(n--) {
-        idx = random() % ins->urls->nelem;
+        if (ins->hosts != NULL) {
+            mpc_url = mpc_http_pick_url(ins);
+            if (mpc_url == NULL) {
+                /* every host has as many requests in flight as it may */
+                break;
+            }
+
+        } else {
+            idx = random() % ins->urls->nelem;
     
-        mpc_url_p = mpc_array_get(ins->urls, idx);
-        ASSERT(mpc_url_p != NULL);
+            mpc_url_p = mpc_array_get(ins->urls, idx);
+            ASSERT(mpc_url_p != NULL);
+
+            mpc_url = *mpc_url_p;
+        }
 
-        mpc_url = *mpc_url_p;
         ASSERT(mpc_url->no_put);
     
         /*
@@ -1947,8 +2853,62 @@ mpc_http_create_missing_requests(mpc_instance_t *ins)
     
         */
 
+        creating = 1;
         mpc_http_process_request(ins, mpc_url, NULL);
+        creating = 0;
+    }
+}
+
+
+/*
+ * Parse a list of status codes such as "200,302,404" or "2xx,3xx" into
+ * the bitmap codes, which must hold MPC_HTTP_MAX_STATUS bits.
+ */
+int
+mpc_http_parse_status_codes(uint8_t *codes, uint8_t *p, size_t len)
+{
+    uint8_t  *last, *start;
+    int       code, i, n;
+
+    mpc_memzero(codes, MPC_HTTP_MAX_STATUS / 8);
+
+    last = p + len;
+    n = 0;
+
+    while (p < last) {
+        if (*p == ',' || *p == ' ') {
+            p++;
+            continue;
+        }
+
+        start = p;
+        while (p < last && *p != ',' && *p != ' ') {
+            p++;
+        }
+
+        if (p - start != 3 || start[0] < '1' || start[0] > '5') {
+            return MPC_ERROR;
+        }
+
+        if ((start[1] | 0x20) == 'x' && (start[2] | 0x20) == 'x') {
+            code = (start[0] - '0') * 100;
+            for (i = 0; i < 100; i++) {
+                mpc_http_status_set(codes, code + i);
+            }
+
+        } else {
+            code = mpc_atoi(start, 3);
+            if (code == MPC_ERROR) {
+                return MPC_ERROR;
+            }
+
+            mpc_http_status_set(codes, code);
+        }
+
+        n++;
     }
+
+    return n ? MPC_OK : MPC_ERROR;
 }
 
 
@@ -40,10 +40,20 @@
 
 #define MPC_HTTP_MAX_REDIRECT           10
 #define MPC_HTTP_MAX_NFREE              128
+#define MPC_HTTP_REQUEST_LEN            96    /* the fixed part of a request */
 
 #define MPC_HTTP_METHOD_GET             0
 #define MPC_HTTP_METHOD_HEAD            1
 
+#define MPC_HTTP_MAX_STATUS             600
+#define MPC_HTTP_DEFAULT_SUCCESS        "200,302,404"
+
+#define mpc_http_status_set(codes, c)                                       \
+    (codes)[(c) >> 3] |= (uint8_t) (1 << ((c) & 7))
+#define mpc_http_status_test(codes, c)                                      \
+    ((c) > 0 && (c) < MPC_HTTP_MAX_STATUS                                   \
+     && ((codes)[(c) >> 3] & (1 << ((c) & 7))))
+
 
 typedef struct mpc_http_s mpc_http_t;
 typedef struct mpc_http_hdr_s mpc_http_hdr_t;
@@ -76,6 +86,7 @@ typedef struct {
 
 
 typedef struct {
+    uint64_t    resolve;
     uint64_t    start;
     uint64_t    connected;
     uint64_t    first_packet_reach;
@@ -92,6 +103,7 @@ struct mpc_http_s {
     mpc_instance_t          *ins;
     mpc_conn_t              *conn;
     mpc_url_t               *url;
+    mpc_pool_t              *host;          /* counted in flight to */
     int                      phase;
     mpc_array_t             *locations;
     int                      http_major;
@@ -109,11 +121,21 @@ struct mpc_http_s {
     int                      content_length_received;
     int                      size;
     int                      length;
+    uint64_t                 received;
+    uint64_t                 header_bytes;  /* status line and headers */
     mpc_http_bench_t         bench;
+    mpc_timer_t              timer;         /* connect, then read */
+    mpc_timer_t              deadline;      /* the whole request */
     unsigned                 need_redirect:1;
+    unsigned                 counted:1;
     unsigned                 used:1;
     unsigned                 chunked:1;
     unsigned                 discard_chunk:1;
+    unsigned                 framed:1;      /* the length of the body known */
+    unsigned                 close:1;       /* "Connection: close" */
+    unsigned                 keep_alive:1;  /* "Connection: keep-alive" */
+    unsigned                 reused:1;      /* sent on a kept connection */
+    unsigned                 queued:1;      /* in the requests of conn */
 };
 
 
@@ -130,6 +152,8 @@ int mpc_http_process_request(mpc_instance_t *ins, mpc_url_t *mpc_url,
 void mpc_http_create_missing_requests(mpc_instance_t *ins);
 uint32_t mpc_http_get_used(void);
 int mpc_http_get_method(char *method);
+int mpc_http_parse_status_codes(uint8_t *codes, uint8_t *p, size_t len);
+int mpc_http_init_hosts(mpc_instance_t *ins);
 
 
 #endif /* __MPC_HTTP_H_INCLUDED__ */
@@ -47,7 +47,7 @@ mpc_event_api_create(mpc_event_loop_t *el)
         return MPC_ERROR;
     }
 
-    state->events = mpc_alloc(sizeof(struct kevent) * el->setsize);
+    state->events = mpc_alloc(sizeof(struct kevent) * el->nevents);
     if (state->events == NULL) {
         mpc_free(state);
         return MPC_ERROR;
@@ -129,11 +129,11 @@ mpc_event_api_poll(mpc_event_loop_t *el, struct timeval *tvp)
     if (tvp != NULL) {
         timeout.tv_sec = tvp->tv_sec;
         timeout.tv_nsec = tvp->tv_usec * 1000;
-        retval = kevent(state->kqfd, NULL, 0, state->events, el->setsize, 
+        retval = kevent(state->kqfd, NULL, 0, state->events, el->nevents,
                         &timeout);
 
     } else {
-        retval = kevent(state->kqfd, NULL, 0, state->events, el->setsize,
+        retval = kevent(state->kqfd, NULL, 0, state->events, el->nevents,
                         NULL);
     }
 
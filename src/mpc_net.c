@@ -120,6 +120,103 @@ mpc_net_tcp_keepalive(int fd)
 }
 
 
+/* close() sends RST instead of FIN and leaves no TIME_WAIT behind */
+int
+mpc_net_tcp_reset(int fd)
+{
+    struct linger  linger;
+
+    linger.l_onoff = 1;
+    linger.l_linger = 0;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger))
+        == -1)
+    {
+        mpc_log_err(errno, "setsockopt SO_LINGER failed, fd: %d", fd);
+        return MPC_ERROR;
+    }
+
+    return MPC_OK;
+}
+
+
+/* the kernel leaves the quick ack mode by itself, it is set after reads */
+int
+mpc_net_tcp_quickack(int fd)
+{
+#ifdef TCP_QUICKACK
+    int  on = 1;
+
+    if (setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on)) == -1) {
+        mpc_log_err(errno, "setsockopt TCP_QUICKACK failed, fd: %d", fd);
+        return MPC_ERROR;
+    }
+#endif
+
+    return MPC_OK;
+}
+
+
+/* 1 when the data sent in the SYN was acknowledged, -1 when unknown */
+int
+mpc_net_tcp_syn_data(int fd)
+{
+#ifdef TCPI_OPT_SYN_DATA
+    struct tcp_info  info;
+    socklen_t        len = sizeof(info);
+
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == -1) {
+        mpc_log_err(errno, "getsockopt TCP_INFO failed, fd: %d", fd);
+        return MPC_ERROR;
+    }
+
+    return (info.tcpi_options & TCPI_OPT_SYN_DATA) ? 1 : 0;
+#else
+    return MPC_ERROR;
+#endif
+}
+
+
+/*
+ * Count the TCP sockets of the system in TIME_WAIT, -1 when it cannot
+ * be known.
+ */
+int
+mpc_net_time_wait(void)
+{
+    FILE      *fp;
+    char       line[MPC_TEMP_BUF_SIZE];
+    char      *files[] = { "/proc/net/tcp", "/proc/net/tcp6" };
+    int        n, found;
+    uint32_t   i, state;
+
+    n = 0;
+    found = 0;
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        fp = fopen(files[i], "r");
+        if (fp == NULL) {
+            continue;
+        }
+
+        found = 1;
+
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            /* "sl local_address rem_address st ..." */
+            if (sscanf(line, "%*s %*s %*s %x", &state) == 1
+                && state == 0x06)
+            {
+                n++;
+            }
+        }
+
+        fclose(fp);
+    }
+
+    return found ? n : -1;
+}
+
+
 int
 mpc_net_read(int fd, uint8_t *buf, int count)
 {
@@ -232,26 +329,318 @@ mpc_net_unix_server(char *path, mode_t perm)
 }
 
 
+/*
+ * Parse an IPv4 or IPv6 address, the latter may be in brackets as in
+ * an url.
+ */
 int
-mpc_net_tcp_connect(char *addr, int port, int flags)
+mpc_net_parse_addr(struct sockaddr_storage *ss, char *text, size_t len)
 {
-    int                 sockfd;
-    struct sockaddr_in  sa;
+    char                  buf[INET6_ADDRSTRLEN];
+    struct sockaddr_in   *sin;
+    struct sockaddr_in6  *sin6;
+
+    if (len >= 2 && text[0] == '[' && text[len - 1] == ']') {
+        text++;
+        len -= 2;
+    }
 
-    if ((sockfd = mpc_net_socket(AF_INET, SOCK_STREAM)) == MPC_ERROR) {
+    if (len >= sizeof(buf)) {
         return MPC_ERROR;
     }
 
-    sa.sin_family = AF_INET;
-    sa.sin_port = htons(port);
+    mpc_memcpy(buf, text, len);
+    buf[len] = '\0';
 
-    if (flags & MPC_NET_NEEDATON) {
-        if (inet_aton(addr, &sa.sin_addr) == 0) {
-            close(sockfd);
+    mpc_memzero(ss, sizeof(struct sockaddr_storage));
+
+    sin = (struct sockaddr_in *) ss;
+
+    if (inet_pton(AF_INET, buf, &sin->sin_addr) == 1) {
+        sin->sin_family = AF_INET;
+        return MPC_OK;
+    }
+
+    sin6 = (struct sockaddr_in6 *) ss;
+
+    if (inet_pton(AF_INET6, buf, &sin6->sin6_addr) == 1) {
+        sin6->sin6_family = AF_INET6;
+        return MPC_OK;
+    }
+
+    return MPC_ERROR;
+}
+
+
+/* an address, or the first one the system resolves a name to */
+int
+mpc_net_resolve(struct sockaddr_storage *ss, char *host)
+{
+    int               rc;
+    struct addrinfo   hints, *res;
+
+    if (mpc_net_parse_addr(ss, host, strlen(host)) == MPC_OK) {
+        return MPC_OK;
+    }
+
+    mpc_memzero(&hints, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    rc = getaddrinfo(host, NULL, &hints, &res);
+    if (rc != 0) {
+        mpc_log_err(0, "getaddrinfo(\"%s\") failed: %s", host,
+                    gai_strerror(rc));
+        return MPC_ERROR;
+    }
+
+    mpc_memzero(ss, sizeof(struct sockaddr_storage));
+    mpc_memcpy(ss, res->ai_addr, res->ai_addrlen);
+
+    freeaddrinfo(res);
+
+    return MPC_OK;
+}
+
+
+static socklen_t
+mpc_net_set_port(struct sockaddr_storage *ss, int port)
+{
+    if (ss->ss_family == AF_INET6) {
+        ((struct sockaddr_in6 *) ss)->sin6_port = htons(port);
+        return sizeof(struct sockaddr_in6);
+    }
+
+    ((struct sockaddr_in *) ss)->sin_port = htons(port);
+    return sizeof(struct sockaddr_in);
+}
+
+
+/*
+ * Parse a source such as "10.0.0.1", "10.0.0.1:20000-29999" or
+ * "[2001:db8::1]:20000-29999", a port range to bind the connections
+ * from in turn.
+ */
+int
+mpc_net_parse_source(mpc_net_source_t *source, char *text)
+{
+    char     *p;
+    int64_t   low, high;
+
+    if (text[0] == '[') {
+        p = strchr(text, ']');
+        if (p == NULL || (p[1] != ':' && p[1] != '\0')) {
             return MPC_ERROR;
         }
+
+        p++;
+
     } else {
-        memcpy(&sa.sin_addr, addr, sizeof(struct in_addr));
+        p = strchr(text, ':');
+
+        /* a bare IPv6 address */
+        if (p != NULL && strchr(p + 1, ':') != NULL) {
+            p = NULL;
+        }
+    }
+
+    if (p == NULL) {
+        p = text + strlen(text);
+    }
+
+    if (mpc_net_parse_addr(&source->addr, text, p - text) != MPC_OK) {
+        return MPC_ERROR;
+    }
+
+    source->low = 0;
+    source->high = 0;
+
+    if (*p == '\0') {
+        source->next = 0;
+        return MPC_OK;
+    }
+
+    p++;
+    text = strchr(p, '-');
+
+    if (text == NULL) {
+        low = mpc_atoi((uint8_t *) p, strlen(p));
+        high = low;
+
+    } else {
+        low = mpc_atoi((uint8_t *) p, text - p);
+        high = mpc_atoi((uint8_t *) text + 1, strlen(text + 1));
+    }
+
+    if (low <= 0 || high < low || high > 65535) {
+        return MPC_ERROR;
+    }
+
+    source->low = (uint16_t) low;
+    source->high = (uint16_t) high;
+    source->next = source->low;
+
+    return MPC_OK;
+}
+
+
+static int
+mpc_net_bind_source(int sockfd, mpc_net_source_t *source)
+{
+    uint32_t                 n;
+    uint16_t                 port;
+    socklen_t                len;
+    struct sockaddr_storage  sa;
+#ifdef IP_BIND_ADDRESS_NO_PORT
+    int                      on = 1;
+#endif
+
+    sa = source->addr;
+
+    if (source->low == 0) {
+#ifdef IP_BIND_ADDRESS_NO_PORT
+        /* the port is chosen by connect(), free per destination */
+        if (setsockopt(sockfd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT,
+                       &on, sizeof(on)) == -1)
+        {
+            mpc_log_warn(errno, "setsockopt IP_BIND_ADDRESS_NO_PORT failed, "
+                         "fd: %d", sockfd);
+        }
+#endif
+        len = mpc_net_set_port(&sa, 0);
+
+        if (bind(sockfd, (struct sockaddr *)&sa, len) == -1) {
+            return MPC_ERROR;
+        }
+
+        return MPC_OK;
+    }
+
+    for (n = source->high - source->low + 1; n; n--) {
+        port = source->next;
+        source->next = (port == source->high) ? source->low : port + 1;
+
+        len = mpc_net_set_port(&sa, port);
+
+        if (bind(sockfd, (struct sockaddr *)&sa, len) == 0) {
+            return MPC_OK;
+        }
+
+        if (errno != EADDRINUSE) {
+            return MPC_ERROR;
+        }
+    }
+
+    /* every port of the range is taken, as connect() says of its own */
+    errno = EADDRNOTAVAIL;
+
+    return MPC_ERROR;
+}
+
+
+/* the buffer sizes go before connect(), they decide the window scale */
+static int
+mpc_net_set_sockopts(int sockfd, mpc_net_sockopts_t *opts)
+{
+    if (opts->nodelay
+        && setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &opts->nodelay,
+                      sizeof(int)) == -1)
+    {
+        mpc_log_err(errno, "setsockopt TCP_NODELAY failed, fd: %d", sockfd);
+        return MPC_ERROR;
+    }
+
+    if (opts->quickack && mpc_net_tcp_quickack(sockfd) != MPC_OK) {
+        return MPC_ERROR;
+    }
+
+    if (opts->rcvbuf
+        && setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &opts->rcvbuf,
+                      sizeof(int)) == -1)
+    {
+        mpc_log_err(errno, "setsockopt SO_RCVBUF %d failed, fd: %d",
+                    opts->rcvbuf, sockfd);
+        return MPC_ERROR;
+    }
+
+    if (opts->sndbuf
+        && setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &opts->sndbuf,
+                      sizeof(int)) == -1)
+    {
+        mpc_log_err(errno, "setsockopt SO_SNDBUF %d failed, fd: %d",
+                    opts->sndbuf, sockfd);
+        return MPC_ERROR;
+    }
+
+#ifdef TCP_USER_TIMEOUT
+    if (opts->user_timeout
+        && setsockopt(sockfd, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                      &opts->user_timeout, sizeof(unsigned)) == -1)
+    {
+        mpc_log_err(errno, "setsockopt TCP_USER_TIMEOUT %ud failed, fd: %d",
+                    opts->user_timeout, sockfd);
+        return MPC_ERROR;
+    }
+#endif
+
+#ifdef TCP_CONGESTION
+    if (opts->congestion != NULL
+        && setsockopt(sockfd, IPPROTO_TCP, TCP_CONGESTION, opts->congestion,
+                      strlen(opts->congestion)) == -1)
+    {
+        mpc_log_err(errno, "setsockopt TCP_CONGESTION \"%s\" failed, fd: %d",
+                    opts->congestion, sockfd);
+        return MPC_ERROR;
+    }
+#endif
+
+    /* connect() returns at once, the SYN leaves with the first write */
+    if (opts->fastopen) {
+#ifdef TCP_FASTOPEN_CONNECT
+        if (setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                       &opts->fastopen, sizeof(int)) == -1)
+        {
+            mpc_log_err(errno, "setsockopt TCP_FASTOPEN_CONNECT failed, "
+                        "fd: %d", sockfd);
+            return MPC_ERROR;
+        }
+#else
+        mpc_log_err(0, "TCP_FASTOPEN_CONNECT is not supported, fd: %d",
+                    sockfd);
+        return MPC_ERROR;
+#endif
+    }
+
+    return MPC_OK;
+}
+
+
+/*
+ * A socket set up to connect, bound to the source if any. A port of a
+ * range is bound without SO_REUSEADDR, or bind() would take ports whose
+ * connections to the destination are in TIME_WAIT still.
+ */
+static int
+mpc_net_tcp_socket(int family, int flags, mpc_net_source_t *source,
+    mpc_net_sockopts_t *opts)
+{
+    int   sockfd, err, off = 0;
+    char  text[INET6_ADDRSTRLEN];
+
+    if ((sockfd = mpc_net_socket(family, SOCK_STREAM)) == MPC_ERROR) {
+        return MPC_ERROR;
+    }
+
+    if (source != NULL && source->low != 0
+        && setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &off,
+                      sizeof(off)) == -1)
+    {
+        err = errno;
+        mpc_log_err(err, "setsockopt() reuseaddr off failed, fd: %d",
+                    sockfd);
+        close(sockfd);
+        errno = err;
+        return MPC_ERROR;
     }
 
     if (flags & MPC_NET_NONBLOCK) {
@@ -266,11 +655,119 @@ mpc_net_tcp_connect(char *addr, int port, int flags)
         return MPC_ERROR;
     }
 
+    if (opts != NULL && mpc_net_set_sockopts(sockfd, opts) != MPC_OK) {
+        err = errno;
+        close(sockfd);
+        errno = err;
+        return MPC_ERROR;
+    }
+
+    if (source != NULL && mpc_net_bind_source(sockfd, source) != MPC_OK) {
+        err = errno;
+        mpc_log_err(err, "bind() source %s failed, fd: %d",
+                    inet_ntop(source->addr.ss_family,
+                              mpc_net_inaddr(&source->addr),
+                              text, sizeof(text)), sockfd);
+        close(sockfd);
+        errno = err;
+        return MPC_ERROR;
+    }
+
+    return sockfd;
+}
+
+
+int
+mpc_net_tcp_connect(int family, char *addr, int port, int flags,
+    mpc_net_source_t *source, mpc_net_sockopts_t *opts)
+{
+    int                      sockfd, err;
+    uint32_t                 tries;
+    socklen_t                len;
+    struct sockaddr_storage  sa;
+
+    mpc_memzero(&sa, sizeof(sa));
+    sa.ss_family = family;
+
+    if (flags & MPC_NET_NEEDATON) {
+        if (inet_pton(family, addr, mpc_net_inaddr(&sa)) != 1) {
+            return MPC_ERROR;
+        }
+    } else {
+        memcpy(mpc_net_inaddr(&sa), addr,
+               family == AF_INET6 ? sizeof(struct in6_addr)
+                                  : sizeof(struct in_addr));
+    }
+
+    len = mpc_net_set_port(&sa, port);
+
+    tries = 1;
+    if (source != NULL && source->low != 0) {
+        tries = source->high - source->low + 1;
+    }
+
+    for ( ;; ) {
+        sockfd = mpc_net_tcp_socket(family, flags, source, opts);
+        if (sockfd == MPC_ERROR) {
+            return MPC_ERROR;
+        }
+
+        if (connect(sockfd, (struct sockaddr *)&sa, len) == 0) {
+            return sockfd;
+        }
+
+        if (errno == EINPROGRESS && (flags & MPC_NET_NONBLOCK)) {
+            return sockfd;
+        }
+
+        err = errno;
+        close(sockfd);
+
+        /* the port is bound to another connection to the destination */
+        if (err != EADDRNOTAVAIL || --tries == 0) {
+            errno = err;
+            return MPC_ERROR;
+        }
+    }
+}
+
+
+int
+mpc_net_unix_connect(char *path, int flags)
+{
+    int                 sockfd, err;
+    struct sockaddr_un  sa;
+
+    if (strlen(path) >= sizeof(sa.sun_path)) {
+        errno = ENAMETOOLONG;
+        return MPC_ERROR;
+    }
+
+    if ((sockfd = mpc_net_socket(AF_LOCAL, SOCK_STREAM)) == MPC_ERROR) {
+        return MPC_ERROR;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+
+    sa.sun_family = AF_LOCAL;
+    strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+
+    if (flags & MPC_NET_NONBLOCK) {
+        if (mpc_net_nonblock(sockfd) != MPC_OK) {
+            close(sockfd);
+            return MPC_ERROR;
+        }
+    }
+
+    /* EAGAIN is a full backlog, not a connect in progress */
     if (connect(sockfd, (struct sockaddr *)&sa, sizeof(sa)) == -1) {
         if (errno == EINPROGRESS && (flags & MPC_NET_NONBLOCK)) {
             return sockfd;
         }
+
+        err = errno;
         close(sockfd);
+        errno = err;
         return MPC_ERROR;
     }
 
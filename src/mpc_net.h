@@ -46,6 +46,34 @@
 #define MPC_NET_NONBLOCK    2
 
 
+/* the in_addr or in6_addr of a sockaddr_in or sockaddr_in6 */
+#define mpc_net_inaddr(ss)                                                    \
+    ((ss)->ss_family == AF_INET6                                              \
+     ? (char *) &((struct sockaddr_in6 *) (ss))->sin6_addr                   \
+     : (char *) &((struct sockaddr_in *) (ss))->sin_addr)
+
+
+/* a local address connections are made from */
+typedef struct {
+    struct sockaddr_storage  addr;
+    uint16_t                 low;       /* port range, 0 for any port */
+    uint16_t                 high;
+    uint16_t                 next;      /* port bound next */
+} mpc_net_source_t;
+
+
+/* the options set on every connection, 0 or NULL to leave the default */
+typedef struct {
+    int              nodelay;
+    int              quickack;
+    int              rcvbuf;
+    int              sndbuf;
+    unsigned         user_timeout;  /* milliseconds */
+    char            *congestion;
+    int              fastopen;      /* the first write goes in the SYN */
+} mpc_net_sockopts_t;
+
+
 int mpc_net_accept(int sockfd, struct sockaddr *sa, socklen_t *len);
 int mpc_net_nonblock(int fd);
 int mpc_net_tcp_keepalive(int fd);
@@ -53,7 +81,16 @@ int mpc_net_read(int fd, uint8_t *buf, int count);
 int mpc_net_write(int fd, uint8_t *buf, int count);
 int mpc_net_tcp_server(char *ip, int port);
 int mpc_net_unix_server(char *path, mode_t perm);
-int mpc_net_tcp_connect(char *addr, int port, int flags);
+int mpc_net_tcp_reset(int fd);
+int mpc_net_tcp_quickack(int fd);
+int mpc_net_tcp_syn_data(int fd);
+int mpc_net_time_wait(void);
+int mpc_net_parse_addr(struct sockaddr_storage *ss, char *text, size_t len);
+int mpc_net_resolve(struct sockaddr_storage *ss, char *host);
+int mpc_net_parse_source(mpc_net_source_t *source, char *text);
+int mpc_net_tcp_connect(int family, char *addr, int port, int flags,
+    mpc_net_source_t *source, mpc_net_sockopts_t *opts);
+int mpc_net_unix_connect(char *path, int flags);
 
 
 #endif /* __MPC_NET_H_INCLUDED__ */
@@ -0,0 +1,239 @@
+/*
+ * mpc -- A Multiple Protocol Client.
+ * Copyright (c) 2013, FengGu <flygoast@gmail.com>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+#include <mpc_core.h>
+
+
+static void mpc_pool_process_idle(mpc_event_loop_t *el, int fd, void *data,
+    int mask);
+static void mpc_pool_drop(mpc_conn_t *conn, mpc_event_loop_t *el);
+
+
+static mpc_pool_t  *mpc_pool_hash[MPC_POOL_HASH_SIZE];
+static uint64_t     mpc_pool_max_requests;   /* per host, 0 unlimited */
+static uint64_t     mpc_pool_max_idle;       /* per host, 0 unlimited */
+
+
+void
+mpc_pool_init(uint64_t max_requests, uint64_t max_idle)
+{
+    mpc_memzero(mpc_pool_hash, sizeof(mpc_pool_hash));
+
+    mpc_pool_max_requests = max_requests;
+    mpc_pool_max_idle = max_idle;
+}
+
+
+void
+mpc_pool_deinit(mpc_event_loop_t *el)
+{
+    uint32_t     i;
+    mpc_pool_t  *pool, *next;
+
+    for (i = 0; i < MPC_POOL_HASH_SIZE; i++) {
+        for (pool = mpc_pool_hash[i]; pool != NULL; pool = next) {
+            next = pool->next;
+
+            while (!TAILQ_EMPTY(&pool->idle)) {
+                mpc_pool_drop(TAILQ_FIRST(&pool->idle), el);
+            }
+
+            if (pool->urls != NULL) {
+                mpc_array_destroy(pool->urls);
+            }
+
+            mpc_free(pool);
+        }
+
+        mpc_pool_hash[i] = NULL;
+    }
+}
+
+
+mpc_pool_t *
+mpc_pool_get(uint8_t *name, size_t len)
+{
+    uint32_t     hash;
+    size_t       n;
+    mpc_pool_t  *pool;
+
+    /* FNV-1a */
+    hash = 2166136261U;
+    for (n = 0; n < len; n++) {
+        hash = (hash ^ name[n]) * 16777619U;
+    }
+
+    hash &= MPC_POOL_HASH_SIZE - 1;
+
+    for (pool = mpc_pool_hash[hash]; pool != NULL; pool = pool->next) {
+        if (pool->name.len == len
+            && mpc_memcmp(pool->name.data, name, len) == 0)
+        {
+            return pool;
+        }
+    }
+
+    pool = mpc_alloc(sizeof(mpc_pool_t) + len);
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->name.data = (uint8_t *)(pool + 1);
+    pool->name.len = len;
+    mpc_memcpy(pool->name.data, name, len);
+
+    TAILQ_INIT(&pool->idle);
+    pool->nidle = 0;
+    TAILQ_INIT(&pool->ready);
+    pool->nrequests = 0;
+    pool->urls = NULL;
+
+    pool->next = mpc_pool_hash[hash];
+    mpc_pool_hash[hash] = pool;
+
+    return pool;
+}
+
+
+/* the connection idle longest goes first, it is the likeliest to be closed */
+mpc_conn_t *
+mpc_pool_take(mpc_pool_t *pool, mpc_event_loop_t *el)
+{
+    mpc_conn_t  *conn;
+
+    conn = TAILQ_FIRST(&pool->idle);
+    if (conn == NULL) {
+        return NULL;
+    }
+
+    TAILQ_REMOVE(&pool->idle, conn, next);
+    pool->nidle--;
+
+    mpc_delete_file_event(el, conn->fd, MPC_READABLE);
+    conn->pool = NULL;
+
+    return conn;
+}
+
+
+/*
+ * Keep a connection whose response was read in full for the next request
+ * to the same host. Until then any event on it means the server closed it.
+ */
+int
+mpc_pool_keep(mpc_pool_t *pool, mpc_conn_t *conn, mpc_event_loop_t *el)
+{
+    if (mpc_pool_max_idle != 0 && pool->nidle >= mpc_pool_max_idle) {
+        return MPC_ERROR;
+    }
+
+    mpc_conn_buf_rewind(conn);
+
+    if (mpc_create_file_event(el, conn->fd, MPC_READABLE,
+                              mpc_pool_process_idle, (void *)conn)
+        == MPC_ERROR)
+    {
+        return MPC_ERROR;
+    }
+
+    conn->pool = pool;
+    TAILQ_INSERT_TAIL(&pool->idle, conn, next);
+    pool->nidle++;
+
+    return MPC_OK;
+}
+
+
+/*
+ * A connection with requests in flight, but fewer than the pipelining
+ * depth, takes the next requests to its host before an idle one does.
+ */
+void
+mpc_pool_ready(mpc_pool_t *pool, mpc_conn_t *conn)
+{
+    ASSERT(!conn->ready && conn->pool == NULL);
+
+    conn->pool = pool;
+    conn->ready = 1;
+    TAILQ_INSERT_TAIL(&pool->ready, conn, next);
+}
+
+
+void
+mpc_pool_busy(mpc_conn_t *conn)
+{
+    if (!conn->ready) {
+        return;
+    }
+
+    TAILQ_REMOVE(&conn->pool->ready, conn, next);
+    conn->ready = 0;
+    conn->pool = NULL;
+}
+
+
+/* the host has as many requests in flight as it may */
+int
+mpc_pool_full(mpc_pool_t *pool)
+{
+    return mpc_pool_max_requests != 0
+           && pool->nrequests >= mpc_pool_max_requests;
+}
+
+
+static void
+mpc_pool_process_idle(mpc_event_loop_t *el, int fd, void *data, int mask)
+{
+    mpc_conn_t  *conn = (mpc_conn_t *)data;
+    char         buf[MPC_TEMP_BUF_SIZE];
+
+    if (read(fd, buf, sizeof(buf)) < 0
+        && (errno == EAGAIN || errno == EINTR))
+    {
+        return;
+    }
+
+    mpc_log_debug(0, "idle connection fd: %d closed", fd);
+
+    mpc_pool_drop(conn, el);
+}
+
+
+static void
+mpc_pool_drop(mpc_conn_t *conn, mpc_event_loop_t *el)
+{
+    mpc_pool_t  *pool = conn->pool;
+
+    TAILQ_REMOVE(&pool->idle, conn, next);
+    pool->nidle--;
+
+    mpc_delete_file_event(el, conn->fd, MPC_READABLE);
+    mpc_conn_release(conn);
+}
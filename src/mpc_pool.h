@@ -0,0 +1,63 @@
+/*
+ * mpc -- A Multiple Protocol Client.
+ * Copyright (c) 2013, FengGu <flygoast@gmail.com>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __MPC_POOL_H_INCLUDED__
+#define __MPC_POOL_H_INCLUDED__
+
+
+#define MPC_POOL_HASH_SIZE      512   /* power of two */
+
+
+/* the connections kept alive to one host:port */
+struct mpc_pool_s {
+    mpc_str_t                   name;      /* host:port */
+    mpc_conn_hdr_t              idle;
+    uint32_t                    nidle;
+    mpc_conn_hdr_t              ready;     /* pipelining, not full */
+    uint32_t                    nrequests; /* in flight to the host */
+    mpc_array_t                *urls;      /* of the host, to pick from */
+    mpc_pool_t                 *next;      /* in the hash chain */
+};
+
+
+void mpc_pool_init(uint64_t max_requests, uint64_t max_idle);
+void mpc_pool_deinit(mpc_event_loop_t *el);
+mpc_pool_t *mpc_pool_get(uint8_t *name, size_t len);
+mpc_conn_t *mpc_pool_take(mpc_pool_t *pool, mpc_event_loop_t *el);
+int mpc_pool_keep(mpc_pool_t *pool, mpc_conn_t *conn, mpc_event_loop_t *el);
+void mpc_pool_ready(mpc_pool_t *pool, mpc_conn_t *conn);
+void mpc_pool_busy(mpc_conn_t *conn);
+int mpc_pool_full(mpc_pool_t *pool);
+
+
+#define mpc_pool_first_ready(pool)  TAILQ_FIRST(&(pool)->ready)
+
+
+#endif /* __MPC_POOL_H_INCLUDED__ */
@@ -48,9 +48,13 @@ typedef struct {
     mpc_gethostbyname_cb   callback;
     void                  *arg;
     mpc_event_loop_t      *el;
+    int                    family;      /* the one asked for now */
+    unsigned               fallback:1;  /* the other family to ask next */
+    char                   name[MPC_TEMP_BUF_SIZE];
 } mpc_resolver_ctx_t;
 
 
+static void mpc_resolver_put(mpc_resolver_ctx_t *ctx);
 static int mpc_resolver_process_timeout(mpc_event_loop_t *el, int64_t id,
     void *data);
 static void mpc_resolver_process_sockstate(void *data, ares_socket_t sock,
@@ -153,17 +157,34 @@ static void
 mpc_resolver_callback(void *arg, int status, int timeouts, struct hostent *host)
 {
     mpc_resolver_ctx_t  *ctx = (mpc_resolver_ctx_t *)arg;
+    mpc_resolver_t      *resolver;
 
     if (status == ARES_EDESTRUCTION) {
         /* do nothing here */
         return;
     }
 
+    /* the name may have addresses of the other family only */
+    if ((status == ARES_ENODATA || status == ARES_ENOTFOUND)
+        && ctx->fallback)
+    {
+        resolver = ctx->el->resolver;
+
+        ctx->family = (ctx->family == AF_INET6) ? AF_INET : AF_INET6;
+        ctx->fallback = 0;
+
+        ares_gethostbyname(resolver->channel, ctx->name, ctx->family,
+                           mpc_resolver_callback, ctx);
+        return;
+    }
+
     if (status != ARES_SUCCESS) {
         ctx->callback(ctx->el, status, NULL, ctx->arg);
     } else {
         ctx->callback(ctx->el, MPC_RESOLVER_OK, host, ctx->arg);
     }
+
+    mpc_resolver_put(ctx);
 }
 
 
@@ -182,14 +203,14 @@ mpc_resolver_process(mpc_event_loop_t *el, int fd, void *arg, int mask)
 }
 
 
-mpc_resolver_ctx_t *
+static mpc_resolver_ctx_t *
 mpc_resolver_get(void)
 {
     return calloc(sizeof(mpc_resolver_ctx_t), 1);
 }
 
 
-void
+static void
 mpc_resolver_put(mpc_resolver_ctx_t *ctx)
 {
     free(ctx);
@@ -198,10 +219,9 @@ mpc_resolver_put(mpc_resolver_ctx_t *ctx)
 
 int
 mpc_gethostbyname(mpc_event_loop_t *el, const uint8_t *name, size_t len,
-    mpc_gethostbyname_cb callback, void *arg)
+    int family, mpc_gethostbyname_cb callback, void *arg)
 {
     mpc_resolver_t       *resolver;
-    char                  buf[MPC_TEMP_BUF_SIZE];
     mpc_resolver_ctx_t   *ctx;
 
     resolver = el->resolver;
@@ -213,15 +233,16 @@ mpc_gethostbyname(mpc_event_loop_t *el, const uint8_t *name, size_t len,
         return MPC_ERROR;
     }
 
-    mpc_memzero(buf, sizeof(buf));
-    mpc_memcpy(buf, name, MPC_MIN(len, sizeof(buf)));
+    mpc_memcpy(ctx->name, name, MPC_MIN(len, sizeof(ctx->name) - 1));
 
     ctx->callback = callback;
     ctx->arg = arg;
     ctx->el = el;
+    ctx->family = family;
+    ctx->fallback = 1;
 
-    ares_gethostbyname(resolver->channel, buf, AF_INET, mpc_resolver_callback,
-                       ctx);
+    ares_gethostbyname(resolver->channel, ctx->name, family,
+                       mpc_resolver_callback, ctx);
 
     return MPC_OK;
 }
@@ -49,8 +49,12 @@ typedef void (*mpc_gethostbyname_cb)(mpc_event_loop_t *el, int status,
 int mpc_resolver_init(mpc_event_loop_t *el, const char *server);
 void mpc_resolver_deinit(mpc_event_loop_t *el);
 
+/*
+ * The name is looked up in 'family' first, AF_INET or AF_INET6, and in
+ * the other one if it has no address there.
+ */
 int mpc_gethostbyname(mpc_event_loop_t *el, const uint8_t *name, size_t len,
-    mpc_gethostbyname_cb callback, void *arg);
+    int family, mpc_gethostbyname_cb callback, void *arg);
 
 
 #endif /* __MPC_RESOLVER_H_INCLUDED__ */
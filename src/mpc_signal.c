@@ -33,6 +33,12 @@
 
 static void mpc_signal_handler(int signo);
 
+
+/* set by the handler only, the event loop does the work */
+volatile sig_atomic_t  mpc_signal_snapshot;
+volatile sig_atomic_t  mpc_signal_reset;
+
+
 #if 0
 
 #ifdef HAVE_BACKTRACE
@@ -45,6 +51,8 @@ static mpc_signal_t signals[] = {
     { SIGINT,  "SIGINT",  0,                 mpc_signal_handler },
     { SIGSEGV, "SIGSEGV", (int)SA_RESETHAND, mpc_signal_handler },
     { SIGPIPE, "SIGPIPE", 0,                 SIG_IGN },
+    { SIGUSR1, "SIGUSR1", SA_RESTART,        mpc_signal_handler },
+    { SIGUSR2, "SIGUSR2", SA_RESTART,        mpc_signal_handler },
     { 0,       NULL,      0,                 NULL}
 };
 
@@ -101,9 +109,13 @@ mpc_signal_handler(int signo)
 
     switch (signo) {
     case SIGUSR1:
+        action_str = ", writing statistics";
+        mpc_signal_snapshot = 1;
         break;
 
     case SIGUSR2:
+        action_str = ", starting a new measurement";
+        mpc_signal_reset = 1;
         break;
 
     case SIGTTIN:
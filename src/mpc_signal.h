@@ -40,6 +40,10 @@ typedef struct {
 } mpc_signal_t;
 
 
+extern volatile sig_atomic_t  mpc_signal_snapshot;
+extern volatile sig_atomic_t  mpc_signal_reset;
+
+
 int mpc_signal_init(void);
 void mpc_signal_deinit(void);
 
@@ -31,11 +31,43 @@
 #include <mpc_core.h>
 
 
+static char *mpc_stat_error_names[MPC_STAT_NERRORS] = {
+    "Resolve",
+    "Refused",
+    "AddrNAvail",
+    "Timeout",
+    "Reset",
+    "Closed",
+    "Protocol",
+    "Status",
+    "Other"
+};
+
+
+/* keys of the causes in json output */
+static char *mpc_stat_error_keys[MPC_STAT_NERRORS] = {
+    "resolve",
+    "refused",
+    "addrnotavail",
+    "timeout",
+    "reset",
+    "closed",
+    "protocol",
+    "status",
+    "other"
+};
+
+
+static mpc_stat_table_t *mpc_stat_table_create(char *other);
+static int mpc_stat_out_flush(mpc_stat_out_t *out);
+static void mpc_stat_table_destroy(mpc_stat_table_t *table);
+
+
 mpc_stat_t *
 mpc_stat_create(void)
 {
     mpc_stat_t  *mpc_stat = mpc_alloc(sizeof(mpc_stat_t));
-    if (stat == NULL) {
+    if (mpc_stat == NULL) {
         return mpc_stat;
     }
 
@@ -44,6 +76,14 @@ mpc_stat_create(void)
         return NULL;
     }
 
+    mpc_stat->urls = mpc_stat_table_create("(other urls)");
+    mpc_stat->hosts = mpc_stat_table_create("(other hosts)");
+
+    if (mpc_stat->urls == NULL || mpc_stat->hosts == NULL) {
+        mpc_stat_destroy(mpc_stat);
+        return NULL;
+    }
+
     return mpc_stat;
 }
 
@@ -58,14 +98,94 @@ mpc_stat_init(mpc_stat_t *mpc_stat)
     mpc_stat->shortest = MPC_MAX_UINT64_VALUE;
     mpc_stat->longest = 0;
     mpc_stat->bytes = 0;
+    mpc_stat->request_bytes = 0;
+    mpc_stat->header_bytes = 0;
+    mpc_stat->body_bytes = 0;
+    mpc_stat->connections = 0;
+    mpc_stat->reused = 0;
+    mpc_stat->fastopen = 0;
+    mpc_stat->syn_data = 0;
+    mpc_stat->time_wait = -1;
     mpc_stat->total_time = 0;
     mpc_stat->start = 0;
     mpc_stat->stop = 0;
 
+    mpc_stat_hist_reset(&mpc_stat->latency);
+    mpc_stat_hist_reset(&mpc_stat->resolve);
+    mpc_stat_hist_reset(&mpc_stat->connect);
+    mpc_stat_hist_reset(&mpc_stat->first_byte);
+    mpc_stat_hist_reset(&mpc_stat->transfer);
+
+    mpc_memzero(mpc_stat->status, sizeof(mpc_stat->status));
+    mpc_memzero(mpc_stat->errors, sizeof(mpc_stat->errors));
+
+    mpc_stat->urls = NULL;
+    mpc_stat->hosts = NULL;
+
+    mpc_memzero(&mpc_stat->warmup, sizeof(mpc_stat_window_t));
+
     return MPC_OK;
 }
 
 
+static void
+mpc_stat_table_reset(mpc_stat_table_t *table)
+{
+    uint32_t           i;
+    mpc_stat_entry_t  *entry;
+
+    /* the entries stay, urls keep pointers to them */
+
+    for (i = 0; i <= MPC_STAT_TABLE_SIZE; i++) {
+        entry = (i == MPC_STAT_TABLE_SIZE) ? &table->other : table->slots[i];
+
+        if (entry == NULL) {
+            continue;
+        }
+
+        entry->ok = 0;
+        entry->failed = 0;
+        entry->bytes = 0;
+        mpc_stat_hist_reset(&entry->latency);
+    }
+}
+
+
+/* drop everything recorded so far and measure again from now */
+void
+mpc_stat_reset(mpc_stat_t *mpc_stat, uint64_t now)
+{
+    mpc_stat_table_t   *urls, *hosts;
+    mpc_stat_window_t   warmup;
+
+    urls = mpc_stat->urls;
+    hosts = mpc_stat->hosts;
+    mpc_memcpy(&warmup, &mpc_stat->warmup, sizeof(mpc_stat_window_t));
+
+    mpc_stat_init(mpc_stat);
+
+    mpc_stat->urls = urls;
+    mpc_stat->hosts = hosts;
+    mpc_memcpy(&mpc_stat->warmup, &warmup, sizeof(mpc_stat_window_t));
+
+    mpc_stat_table_reset(urls);
+    mpc_stat_table_reset(hosts);
+
+    mpc_stat->start = now;
+}
+
+
+/* keep what the warm-up recorded aside, then start measuring */
+void
+mpc_stat_warmup_done(mpc_stat_t *mpc_stat, uint64_t now)
+{
+    mpc_stat_window_open(&mpc_stat->warmup, mpc_stat, mpc_stat->start);
+    mpc_stat->warmup.stop = now;
+
+    mpc_stat_reset(mpc_stat, now);
+}
+
+
 #if 0
 
 static void 
@@ -88,10 +208,123 @@ void
 mpc_stat_destroy(mpc_stat_t *mpc_stat)
 {
     ASSERT(mpc_stat->magic == MPC_STAT_MAGIC);
+
+    if (mpc_stat->urls != NULL) {
+        mpc_stat_table_destroy(mpc_stat->urls);
+    }
+
+    if (mpc_stat->hosts != NULL) {
+        mpc_stat_table_destroy(mpc_stat->hosts);
+    }
+
     mpc_free(mpc_stat);
 }
 
 
+static mpc_stat_table_t *
+mpc_stat_table_create(char *other)
+{
+    mpc_stat_table_t  *table;
+
+    table = mpc_calloc(1, sizeof(mpc_stat_table_t));
+    if (table == NULL) {
+        return NULL;
+    }
+
+    table->other.name.data = (uint8_t *)other;
+    table->other.name.len = strlen(other);
+    mpc_stat_hist_reset(&table->other.latency);
+
+    return table;
+}
+
+
+static void
+mpc_stat_table_destroy(mpc_stat_table_t *table)
+{
+    uint32_t  i;
+
+    for (i = 0; i < MPC_STAT_TABLE_SIZE; i++) {
+        if (table->slots[i] != NULL) {
+            mpc_free(table->slots[i]);
+        }
+    }
+
+    mpc_free(table);
+}
+
+
+/*
+ * Find the entry of name, creating it on first use. Once the table holds
+ * MPC_STAT_TABLE_MAX entries, new names share the "other" entry, so memory
+ * stays bounded whatever the url file contains.
+ */
+mpc_stat_entry_t *
+mpc_stat_table_get(mpc_stat_table_t *table, uint8_t *name, size_t len)
+{
+    uint32_t           hash, i;
+    size_t             n;
+    mpc_stat_entry_t  *entry;
+
+    /* FNV-1a */
+    hash = 2166136261U;
+    for (n = 0; n < len; n++) {
+        hash = (hash ^ name[n]) * 16777619U;
+    }
+
+    for (i = hash & (MPC_STAT_TABLE_SIZE - 1);
+         table->slots[i] != NULL;
+         i = (i + 1) & (MPC_STAT_TABLE_SIZE - 1))
+    {
+        entry = table->slots[i];
+
+        if (entry->name.len == len
+            && mpc_memcmp(entry->name.data, name, len) == 0)
+        {
+            return entry;
+        }
+    }
+
+    if (table->nelem >= MPC_STAT_TABLE_MAX) {
+        return &table->other;
+    }
+
+    entry = mpc_alloc(sizeof(mpc_stat_entry_t) + len);
+    if (entry == NULL) {
+        return &table->other;
+    }
+
+    entry->name.data = (uint8_t *)(entry + 1);
+    entry->name.len = len;
+    mpc_memcpy(entry->name.data, name, len);
+
+    entry->ok = 0;
+    entry->failed = 0;
+    entry->bytes = 0;
+    mpc_stat_hist_reset(&entry->latency);
+
+    table->slots[i] = entry;
+    table->nelem++;
+
+    return entry;
+}
+
+
+void
+mpc_stat_entry_record(mpc_stat_entry_t *entry, int ok, uint64_t bytes,
+    uint64_t elapsed)
+{
+    if (ok) {
+        entry->ok++;
+    } else {
+        entry->failed++;
+    }
+
+    entry->bytes += bytes;
+    mpc_stat_hist_record(&entry->latency, elapsed);
+}
+
+
 void
 mpc_stat_set_longest(mpc_stat_t *mpc_stat, uint64_t longest)
 {
@@ -110,194 +343,1446 @@ mpc_stat_set_shortest(mpc_stat_t *mpc_stat, uint64_t shortest)
 }
 
 
-static uint32_t
-mpc_stat_get_transactions(mpc_stat_t *mpc_stat)
+void
+mpc_stat_hist_reset(mpc_stat_hist_t *hist)
 {
-    return mpc_stat->ok + mpc_stat->failed;
+    mpc_memzero(hist, sizeof(mpc_stat_hist_t));
+    hist->min = MPC_MAX_UINT64_VALUE;
 }
 
 
-static double
-mpc_stat_get_availability(mpc_stat_t *mpc_stat)
+static uint32_t
+mpc_stat_hist_index(uint64_t value)
 {
-    return mpc_stat->ok / (double)(mpc_stat->ok + mpc_stat->failed) * 100;
-}
+    uint32_t  shift;
 
+    if (value >= (1ULL << MPC_STAT_HIST_MAX_BITS)) {
+        return MPC_STAT_HIST_NBUCKETS - 1;
+    }
 
-static double 
-mpc_stat_get_elapsed(mpc_stat_t *mpc_stat)
-{
-    return (mpc_stat->stop - mpc_stat->start) / (double)1000;
-}
+    if (value < (2ULL << MPC_STAT_HIST_SUB_BITS)) {
+        return (uint32_t) value;
+    }
 
+    /* position of the highest set bit minus the sub bucket bits */
+    shift = 63 - __builtin_clzll(value) - MPC_STAT_HIST_SUB_BITS;
 
-static double
-mpc_stat_get_data_transfered(mpc_stat_t *mpc_stat)
-{
-    return mpc_stat->bytes / (double)(1024 * 1024);
+    return (shift << MPC_STAT_HIST_SUB_BITS) + (uint32_t) (value >> shift);
 }
 
 
-static double
-mpc_stat_get_response_time(mpc_stat_t *mpc_stat)
+static uint64_t
+mpc_stat_hist_value(uint32_t idx)
 {
-    return mpc_stat->total_time / 1000 / (double)(mpc_stat->ok + mpc_stat->failed);
-}
+    uint32_t  shift;
+    uint64_t  sub;
+
+    if (idx < (2U << MPC_STAT_HIST_SUB_BITS)) {
+        return idx;
+    }
 
+    /* the highest value which falls into the bucket */
+    shift = (idx >> MPC_STAT_HIST_SUB_BITS) - 1;
+    sub = idx - (shift << MPC_STAT_HIST_SUB_BITS);
 
-static double
-mpc_stat_get_transaction_rate(mpc_stat_t *mpc_stat)
-{
-    return (mpc_stat->ok + mpc_stat->failed) / 
-           (double)((mpc_stat->stop - mpc_stat->start) / 1000);
+    return ((sub + 1) << shift) - 1;
 }
 
 
-static double
-mpc_stat_get_throughput(mpc_stat_t *mpc_stat)
+void
+mpc_stat_hist_record(mpc_stat_hist_t *hist, uint64_t value)
 {
-    return ((mpc_stat->bytes / 1024 / 1024)) / 
-           (double)((mpc_stat->stop - mpc_stat->start) / 1000);
+    hist->buckets[mpc_stat_hist_index(value)]++;
+    hist->count++;
+    hist->sum += value;
+
+    if (value < hist->min) {
+        hist->min = value;
+    }
+
+    if (value > hist->max) {
+        hist->max = value;
+    }
 }
 
 
-static double
-mpc_stat_get_concurrency(mpc_stat_t *mpc_stat)
+void
+mpc_stat_hist_merge(mpc_stat_hist_t *dst, mpc_stat_hist_t *src)
 {
-    return mpc_stat->total_time / (double)(mpc_stat->stop - mpc_stat->start);
+    uint32_t  i;
+
+    if (src->count == 0) {
+        return;
+    }
+
+    for (i = 0; i < MPC_STAT_HIST_NBUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+
+    dst->count += src->count;
+    dst->sum += src->sum;
+    dst->min = MPC_MIN(dst->min, src->min);
+    dst->max = MPC_MAX(dst->max, src->max);
 }
 
 
-static double
-mpc_stat_get_longest(mpc_stat_t *mpc_stat)
+/*
+ * Return the value below which the given percentage (0 - 100) of the
+ * recorded samples fall, reported as the upper bound of its bucket.
+ */
+uint64_t
+mpc_stat_hist_percentile(mpc_stat_hist_t *hist, double percentile)
 {
-    return mpc_stat->longest / (double)1000;
+    uint64_t  rank, seen;
+    uint32_t  i;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    rank = (uint64_t) (percentile / 100 * hist->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    if (rank >= hist->count) {
+        return hist->max;
+    }
+
+    seen = 0;
+
+    for (i = 0; i < MPC_STAT_HIST_NBUCKETS; i++) {
+        seen += hist->buckets[i];
+
+        if (seen >= rank) {
+            return MPC_MAX(MPC_MIN(mpc_stat_hist_value(i), hist->max),
+                           hist->min);
+        }
+    }
+
+    return hist->max;
 }
 
 
-static double
-mpc_stat_get_shortest(mpc_stat_t *mpc_stat)
+void
+mpc_stat_window_open(mpc_stat_window_t *window, mpc_stat_t *mpc_stat,
+    uint64_t now)
 {
-    return mpc_stat->shortest / (double)1000;
+    window->start = now;
+    window->stop = 0;
+    window->ok = mpc_stat->ok;
+    window->failed = mpc_stat->failed;
+    window->bytes = mpc_stat->bytes;
+    mpc_memcpy(&window->latency, &mpc_stat->latency, sizeof(mpc_stat_hist_t));
 }
-    
 
+
+/*
+ * Fill delta with what was recorded since the window was opened. Only
+ * the buckets are known for the latency difference, so its min and max
+ * are bounded by the lowest and highest bucket used.
+ */
 void
-mpc_stat_print(mpc_stat_t *mpc_stat)
+mpc_stat_window_close(mpc_stat_window_t *window, mpc_stat_t *mpc_stat,
+    uint64_t now, mpc_stat_window_t *delta)
 {
-    if (mpc_stat->ok + mpc_stat->failed == 0) {
-        printf("No transaction completed" CRLF);
-        return;
-    }
+    uint32_t          i;
+    mpc_stat_hist_t  *hist, *cur, *last;
 
-    printf("Transactions:                       %12u hits" CRLF
-           "Availability:                       %12.2f %%" CRLF
-           "Elapsed time:                       %12.2f secs" CRLF
-           "Data transferred:                   %12.2f MB" CRLF
-           "Response time:                      %12.2f secs" CRLF
-           "Transaction rate:                   %12.2f trans/sec" CRLF
-           "Throughput:                         %12.2f MB/sec" CRLF
-           "Concurrency:                        %12.2f" CRLF
-           "Successful transactions:            %12u" CRLF
-           "Failed transactions:                %12u" CRLF
-           "Longest transaction:                %12.2f" CRLF
-           "Shortest transaction:               %12.2f" CRLF
-           CRLF,
-           mpc_stat_get_transactions(mpc_stat),
-           mpc_stat_get_availability(mpc_stat),
-           mpc_stat_get_elapsed(mpc_stat),
-           mpc_stat_get_data_transfered(mpc_stat),
-           mpc_stat_get_response_time(mpc_stat),
-           mpc_stat_get_transaction_rate(mpc_stat),
-           mpc_stat_get_throughput(mpc_stat),
-           mpc_stat_get_concurrency(mpc_stat),
-           mpc_stat_get_ok(mpc_stat),
-           mpc_stat_get_failed(mpc_stat),
-           mpc_stat_get_longest(mpc_stat),
-           mpc_stat_get_shortest(mpc_stat));
+    delta->start = window->start;
+    delta->stop = now;
+    delta->ok = mpc_stat->ok - window->ok;
+    delta->failed = mpc_stat->failed - window->failed;
+    delta->bytes = mpc_stat->bytes - window->bytes;
+
+    hist = &delta->latency;
+    cur = &mpc_stat->latency;
+    last = &window->latency;
+
+    mpc_stat_hist_reset(hist);
+
+    hist->count = cur->count - last->count;
+    hist->sum = cur->sum - last->sum;
+
+    for (i = 0; i < MPC_STAT_HIST_NBUCKETS; i++) {
+        hist->buckets[i] = cur->buckets[i] - last->buckets[i];
+
+        if (hist->buckets[i] == 0) {
+            continue;
+        }
+
+        if (hist->min == MPC_MAX_UINT64_VALUE) {
+            hist->min = MPC_MAX(i == 0 ? 0 : mpc_stat_hist_value(i - 1) + 1,
+                                cur->min);
+        }
+
+        hist->max = MPC_MIN(mpc_stat_hist_value(i), cur->max);
+    }
 }
 
 
+/*
+ * Parse an objective such as "p99 < 50ms", "p99.9 <= 200us",
+ * "error_rate < 0.1%" or "rps > 20000". Latencies without a unit are
+ * in milliseconds.
+ */
 int
-mpc_stat_result_create(const char *file)
+mpc_stat_slo_parse(mpc_stat_slo_t *slo, char *text)
 {
-    int    fd;
-    char   head[] = "        Date & Time,     Trans,  Elap Time,  Data Trans,  "
-     "Resp Time,  Trans Rate,  Throughput,  Concurrent,      OKAY,    Failed\n";
+    char    *p, *end;
+    size_t   len;
+    double   scale;
 
-    if (access(file, F_OK) == 0) {
-        if ((fd = open(file, O_WRONLY|O_APPEND, 0644)) < 0) {
-            mpc_log_err(errno, "open result file \"%s\" failed", file);
+    mpc_memzero(slo, sizeof(mpc_stat_slo_t));
+
+    p = text;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+
+    len = strcspn(p, " \t<>");
+
+    if ((*p == 'p' || *p == 'P') && len > 1) {
+        slo->metric = MPC_STAT_SLO_LATENCY;
+        slo->percentile = strtod(p + 1, &end);
+        if (end != p + len || slo->percentile <= 0 || slo->percentile > 100) {
             return MPC_ERROR;
         }
 
-        return fd;
+    } else if (len == sizeof("error_rate") - 1
+               && strncasecmp(p, "error_rate", len) == 0)
+    {
+        slo->metric = MPC_STAT_SLO_ERROR_RATE;
+
+    } else if (len == sizeof("rps") - 1 && strncasecmp(p, "rps", len) == 0) {
+        slo->metric = MPC_STAT_SLO_RPS;
+
+    } else {
+        return MPC_ERROR;
     }
 
-    if ((fd = open(file, O_CREAT|O_WRONLY|O_APPEND, 0644)) < 0) {
-        mpc_log_err(errno, "open result file \"%s\" failed", file);
+    p += len;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+
+    if (*p == '<') {
+        slo->op = MPC_STAT_SLO_LT;
+
+    } else if (*p == '>') {
+        slo->op = MPC_STAT_SLO_GT;
+
+    } else {
         return MPC_ERROR;
     }
 
-    if (write(fd, head, sizeof(head) - 1) < 0) {
-        mpc_log_err(errno, "write head to fd:%d failed", fd);
-        close(fd);
+    if (*++p == '=') {
+        slo->op++;
+        p++;
+    }
+
+    slo->target = strtod(p, &end);
+    if (end == p || slo->target < 0) {
         return MPC_ERROR;
     }
 
-    return fd;
-}
+    p = end;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
 
+    scale = 1;
 
-int
-mpc_stat_result_record(int fd, mpc_stat_t *mpc_stat, char *mark)
-{
-    char        entry[MPC_TEMP_BUF_SIZE];
-    char        date[65];
-    struct tm   keepsake;
-    struct tm  *tmp;
-    time_t      now;
+    switch (slo->metric) {
+    case MPC_STAT_SLO_LATENCY:
+        if (*p == '\0' || strcmp(p, "ms") == 0) {
+            scale = 1000;
 
-    if (mpc_stat->ok + mpc_stat->failed == 0) {
-        return MPC_OK;
-    }
+        } else if (strcmp(p, "s") == 0) {
+            scale = 1000000;
 
-    if (mark != NULL) {
-        snprintf(entry, sizeof(entry), "**** %s ****\n", mark);
+        } else if (strcmp(p, "us") != 0) {
+            return MPC_ERROR;
+        }
+        break;
 
-        if (write(fd, entry, strlen(entry)) < 0) {
-            mpc_log_err(errno, "write mark \"%s\" to fd:%d failed", mark, fd);
-            close(fd);
+    case MPC_STAT_SLO_ERROR_RATE:
+        if (*p != '\0' && strcmp(p, "%") != 0) {
             return MPC_ERROR;
         }
+        break;
+
+    default:
+        if (*p != '\0') {
+            return MPC_ERROR;
+        }
+        break;
     }
 
-    now = time(NULL);
-    tmp = (struct tm *)localtime_r(&now, &keepsake);
+    slo->target *= scale;
 
-    setlocale(LC_TIME, "C");
-    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", tmp);
+    snprintf(slo->text, MPC_STAT_SLO_TEXT_SIZE, "%s", text);
 
-    snprintf(entry, sizeof(entry), 
-             "%19.19s,%10d,%11.2f,%12u,%11.2f,%12.2f,%12.2f,%12.2f,%10u,%10u\n",
-             date, 
-             mpc_stat_get_transactions(mpc_stat),
-             mpc_stat_get_elapsed(mpc_stat),
-             (uint32_t)mpc_stat_get_data_transfered(mpc_stat),
-             mpc_stat_get_response_time(mpc_stat),
-             mpc_stat_get_transaction_rate(mpc_stat),
-             mpc_stat_get_throughput(mpc_stat),
-             mpc_stat_get_concurrency(mpc_stat),
-             mpc_stat_get_ok(mpc_stat),
-             mpc_stat_get_failed(mpc_stat));
+    return MPC_OK;
+}
 
-    if (write(fd, entry, strlen(entry)) < 0) {
-        mpc_log_err(errno, "write entry \"%s\" to fd:%d failed", entry, fd);
-        close(fd);
-        return MPC_ERROR;
-    }
 
-    return MPC_OK;
+/*
+ * Check an objective against the requests completed in a window. It
+ * returns MPC_ERROR when the objective was missed, windows without the
+ * requests to judge it by are not counted.
+ */
+int
+mpc_stat_slo_check(mpc_stat_slo_t *slo, mpc_stat_window_t *delta)
+{
+    double    value;
+    uint32_t  total;
+    int       met;
+
+    total = delta->ok + delta->failed;
+
+    switch (slo->metric) {
+    case MPC_STAT_SLO_LATENCY:
+        if (delta->latency.count == 0) {
+            return MPC_OK;
+        }
+
+        value = mpc_stat_hist_percentile(&delta->latency, slo->percentile);
+        break;
+
+    case MPC_STAT_SLO_ERROR_RATE:
+        if (total == 0) {
+            return MPC_OK;
+        }
+
+        value = delta->failed * 100 / (double) total;
+        break;
+
+    default:
+        if (delta->stop <= delta->start) {
+            return MPC_OK;
+        }
+
+        value = total / ((delta->stop - delta->start) / (double)1000000);
+        break;
+    }
+
+    switch (slo->op) {
+    case MPC_STAT_SLO_LT:
+        met = value < slo->target;
+        break;
+
+    case MPC_STAT_SLO_LE:
+        met = value <= slo->target;
+        break;
+
+    case MPC_STAT_SLO_GT:
+        met = value > slo->target;
+        break;
+
+    default:
+        met = value >= slo->target;
+        break;
+    }
+
+    if (slo->windows++ == 0
+        || (slo->op <= MPC_STAT_SLO_LE ? value > slo->worst
+                                       : value < slo->worst))
+    {
+        slo->worst = value;
+    }
+
+    if (!met) {
+        slo->missed++;
+        return MPC_ERROR;
+    }
+
+    return MPC_OK;
+}
+
+
+void
+mpc_stat_slo_print(mpc_array_t *slos, uint64_t tolerance)
+{
+    uint32_t         i;
+    double           worst;
+    char            *unit;
+    mpc_stat_slo_t  *slo;
+
+    printf(CRLF "Objectives (%llu missed windows tolerated):" CRLF,
+           (unsigned long long) tolerance);
+
+    for (i = 0; i < slos->nelem; i++) {
+        slo = mpc_array_get(slos, i);
+
+        worst = slo->worst;
+        unit = "";
+
+        if (slo->metric == MPC_STAT_SLO_LATENCY) {
+            worst /= 1000;
+            unit = " ms";
+
+        } else if (slo->metric == MPC_STAT_SLO_ERROR_RATE) {
+            unit = " %";
+        }
+
+        if (slo->windows == 0) {
+            printf("%-24s not checked" CRLF, slo->text);
+            continue;
+        }
+
+        printf("%-24s %s, missed %u of %u windows, worst %.3f%s" CRLF,
+               slo->text, slo->missed > tolerance ? "BROKEN" : "met",
+               slo->missed, slo->windows, worst, unit);
+    }
+}
+
+
+static uint32_t
+mpc_stat_get_transactions(mpc_stat_t *mpc_stat)
+{
+    return mpc_stat->ok + mpc_stat->failed;
+}
+
+
+static double
+mpc_stat_get_availability(mpc_stat_t *mpc_stat)
+{
+    return mpc_stat->ok / (double)(mpc_stat->ok + mpc_stat->failed) * 100;
+}
+
+
+static double 
+mpc_stat_get_elapsed(mpc_stat_t *mpc_stat)
+{
+    return (mpc_stat->stop - mpc_stat->start) / (double)1000000;
+}
+
+
+static double
+mpc_stat_get_data_transfered(mpc_stat_t *mpc_stat)
+{
+    return mpc_stat->bytes / (double)(1024 * 1024);
+}
+
+
+static double
+mpc_stat_get_response_time(mpc_stat_t *mpc_stat)
+{
+    return mpc_stat->total_time / (double)1000000
+           / (mpc_stat->ok + mpc_stat->failed);
+}
+
+
+static double
+mpc_stat_get_transaction_rate(mpc_stat_t *mpc_stat)
+{
+    return (mpc_stat->ok + mpc_stat->failed) / 
+           ((mpc_stat->stop - mpc_stat->start) / (double)1000000);
+}
+
+
+static double
+mpc_stat_get_throughput(mpc_stat_t *mpc_stat)
+{
+    return (mpc_stat->bytes / (double)(1024 * 1024)) / 
+           ((mpc_stat->stop - mpc_stat->start) / (double)1000000);
+}
+
+
+static double
+mpc_stat_get_mbytes_rate(mpc_stat_t *mpc_stat, uint64_t bytes)
+{
+    return (bytes / (double)(1024 * 1024)) /
+           ((mpc_stat->stop - mpc_stat->start) / (double)1000000);
+}
+
+
+static double
+mpc_stat_get_concurrency(mpc_stat_t *mpc_stat)
+{
+    return mpc_stat->total_time / (double)(mpc_stat->stop - mpc_stat->start);
+}
+
+
+static double
+mpc_stat_get_longest(mpc_stat_t *mpc_stat)
+{
+    return mpc_stat->longest / (double)1000000;
+}
+
+
+static double
+mpc_stat_get_shortest(mpc_stat_t *mpc_stat)
+{
+    return mpc_stat->shortest / (double)1000000;
+}
+
+
+static double
+mpc_stat_get_percentile(mpc_stat_t *mpc_stat, double percentile)
+{
+    return mpc_stat_hist_percentile(&mpc_stat->latency, percentile)
+           / (double)1000000;
+}
+    
+
+static void
+mpc_stat_print_phase(char *name, mpc_stat_hist_t *hist)
+{
+    if (hist->count == 0) {
+        return;
+    }
+
+    printf("  %-12s%12.6f%12.6f%12.6f%12.6f%12.6f" CRLF,
+           name,
+           mpc_stat_hist_percentile(hist, 50) / (double)1000000,
+           mpc_stat_hist_percentile(hist, 90) / (double)1000000,
+           mpc_stat_hist_percentile(hist, 99) / (double)1000000,
+           mpc_stat_hist_percentile(hist, 99.9) / (double)1000000,
+           hist->max / (double)1000000);
+}
+
+
+/* classify the errno of a failed socket call */
+int
+mpc_stat_error_type(int err)
+{
+    switch (err) {
+    case ECONNREFUSED:
+        return MPC_STAT_ERR_REFUSED;
+
+    case EADDRNOTAVAIL:
+        return MPC_STAT_ERR_ADDRNOTAVAIL;
+
+    case ETIMEDOUT:
+        return MPC_STAT_ERR_TIMEDOUT;
+
+    case ECONNRESET:
+    case EPIPE:
+        return MPC_STAT_ERR_RESET;
+
+    default:
+        return MPC_STAT_ERR_OTHER;
+    }
+}
+
+
+static int
+mpc_stat_cmp_count(const void *a, const void *b)
+{
+    mpc_stat_entry_t  *ea = *(mpc_stat_entry_t **)a;
+    mpc_stat_entry_t  *eb = *(mpc_stat_entry_t **)b;
+    uint64_t           ca = ea->ok + ea->failed;
+    uint64_t           cb = eb->ok + eb->failed;
+
+    return (ca < cb) - (ca > cb);
+}
+
+
+static int
+mpc_stat_cmp_slowest(const void *a, const void *b)
+{
+    mpc_stat_entry_t  *ea = *(mpc_stat_entry_t **)a;
+    mpc_stat_entry_t  *eb = *(mpc_stat_entry_t **)b;
+    uint64_t           pa = mpc_stat_hist_percentile(&ea->latency, 99);
+    uint64_t           pb = mpc_stat_hist_percentile(&eb->latency, 99);
+
+    return (pa < pb) - (pa > pb);
+}
+
+
+static int
+mpc_stat_cmp_failed(const void *a, const void *b)
+{
+    mpc_stat_entry_t  *ea = *(mpc_stat_entry_t **)a;
+    mpc_stat_entry_t  *eb = *(mpc_stat_entry_t **)b;
+
+    return (ea->failed < eb->failed) - (ea->failed > eb->failed);
+}
+
+
+static void
+mpc_stat_print_table(mpc_stat_table_t *table, char *title,
+    mpc_array_cmp_pt *cmp, int failed_only)
+{
+    uint32_t            i, n;
+    mpc_array_t        *a;
+    mpc_stat_entry_t  **entry;
+
+    a = mpc_array_create(table->nelem + 1, sizeof(mpc_stat_entry_t *));
+    if (a == NULL) {
+        return;
+    }
+
+    for (i = 0; i < MPC_STAT_TABLE_SIZE; i++) {
+        if (table->slots[i] == NULL) {
+            continue;
+        }
+
+        if (failed_only && table->slots[i]->failed == 0) {
+            continue;
+        }
+
+        entry = mpc_array_push(a);
+        *entry = table->slots[i];
+    }
+
+    if (table->other.ok + table->other.failed != 0
+        && (!failed_only || table->other.failed != 0))
+    {
+        entry = mpc_array_push(a);
+        *entry = &table->other;
+    }
+
+    if (a->nelem == 0) {
+        mpc_array_destroy(a);
+        return;
+    }
+
+    mpc_array_sort(a, cmp);
+
+    printf("%s" CRLF
+           "     Trans     Failed          MB         50%%         99%%"
+           "         max  Name" CRLF, title);
+
+    n = MPC_MIN(a->nelem, MPC_STAT_TOP_N);
+
+    for (i = 0; i < n; i++) {
+        entry = mpc_array_get(a, i);
+
+        printf("%10u %10u %11.2f %11.6f %11.6f %11.6f  %.*s" CRLF,
+               (*entry)->ok + (*entry)->failed,
+               (*entry)->failed,
+               (*entry)->bytes / (double)(1024 * 1024),
+               mpc_stat_hist_percentile(&(*entry)->latency, 50)
+               / (double)1000000,
+               mpc_stat_hist_percentile(&(*entry)->latency, 99)
+               / (double)1000000,
+               (*entry)->latency.max / (double)1000000,
+               (int)(*entry)->name.len, (*entry)->name.data);
+    }
+
+    printf(CRLF);
+
+    mpc_array_destroy(a);
+}
+
+
+void
+mpc_stat_print(mpc_stat_t *mpc_stat)
+{
+    int  i;
+
+    if (mpc_stat->ok + mpc_stat->failed == 0) {
+        printf("No transaction completed" CRLF);
+        return;
+    }
+
+    printf("Transactions:                       %12u hits" CRLF
+           "Availability:                       %12.2f %%" CRLF
+           "Elapsed time:                       %12.2f secs" CRLF
+           "Data transferred:                   %12.2f MB" CRLF
+           "Response time:                      %12.6f secs" CRLF
+           "Transaction rate:                   %12.2f trans/sec" CRLF
+           "Throughput:                         %12.2f MB/sec" CRLF
+           "Concurrency:                        %12.2f" CRLF
+           "Successful transactions:            %12u" CRLF
+           "Failed transactions:                %12u" CRLF
+           "Longest transaction:                %12.6f" CRLF
+           "Shortest transaction:               %12.6f" CRLF
+           CRLF
+           "Response time 50%%:                  %12.6f secs" CRLF
+           "Response time 90%%:                  %12.6f secs" CRLF
+           "Response time 99%%:                  %12.6f secs" CRLF
+           "Response time 99.9%%:                %12.6f secs" CRLF
+           "Response time 99.99%%:               %12.6f secs" CRLF
+           "Response time max:                  %12.6f secs" CRLF
+           CRLF
+           "Requests sent:                      %12.2f MB %10.2f MB/sec" CRLF
+           "Response headers received:          %12.2f MB %10.2f MB/sec" CRLF
+           "Response bodies received:           %12.2f MB %10.2f MB/sec" CRLF
+           "Connections opened:                 %12u" CRLF
+           "Transactions on reused connections: %12.2f %%" CRLF
+           CRLF,
+           mpc_stat_get_transactions(mpc_stat),
+           mpc_stat_get_availability(mpc_stat),
+           mpc_stat_get_elapsed(mpc_stat),
+           mpc_stat_get_data_transfered(mpc_stat),
+           mpc_stat_get_response_time(mpc_stat),
+           mpc_stat_get_transaction_rate(mpc_stat),
+           mpc_stat_get_throughput(mpc_stat),
+           mpc_stat_get_concurrency(mpc_stat),
+           mpc_stat_get_ok(mpc_stat),
+           mpc_stat_get_failed(mpc_stat),
+           mpc_stat_get_longest(mpc_stat),
+           mpc_stat_get_shortest(mpc_stat),
+           mpc_stat_get_percentile(mpc_stat, 50),
+           mpc_stat_get_percentile(mpc_stat, 90),
+           mpc_stat_get_percentile(mpc_stat, 99),
+           mpc_stat_get_percentile(mpc_stat, 99.9),
+           mpc_stat_get_percentile(mpc_stat, 99.99),
+           mpc_stat_get_percentile(mpc_stat, 100),
+           mpc_stat->request_bytes / (double)(1024 * 1024),
+           mpc_stat_get_mbytes_rate(mpc_stat, mpc_stat->request_bytes),
+           mpc_stat->header_bytes / (double)(1024 * 1024),
+           mpc_stat_get_mbytes_rate(mpc_stat, mpc_stat->header_bytes),
+           mpc_stat->body_bytes / (double)(1024 * 1024),
+           mpc_stat_get_mbytes_rate(mpc_stat, mpc_stat->body_bytes),
+           mpc_stat->connections,
+           mpc_stat_get_transactions(mpc_stat)
+           ? mpc_stat->reused * 100
+             / (double) mpc_stat_get_transactions(mpc_stat)
+           : 0.0);
+
+    if (mpc_stat->fastopen != 0) {
+        printf("Connections with data in SYN:       %12.2f %%" CRLF CRLF,
+               mpc_stat->syn_data * 100 / (double) mpc_stat->fastopen);
+    }
+
+    if (mpc_stat->time_wait >= 0) {
+        printf("TIME_WAIT sockets at the end:       %12d" CRLF CRLF,
+               mpc_stat->time_wait);
+    }
+
+    if (mpc_stat->warmup.stop != 0) {
+        printf("Warm-up time (excluded):            %12.2f secs" CRLF
+               "Warm-up transactions:               %12u hits" CRLF
+               "Warm-up failed transactions:        %12u" CRLF
+               "Warm-up response time 99%%:          %12.6f secs" CRLF
+               CRLF,
+               (mpc_stat->warmup.stop - mpc_stat->warmup.start)
+               / (double)1000000,
+               mpc_stat->warmup.ok + mpc_stat->warmup.failed,
+               mpc_stat->warmup.failed,
+               mpc_stat_hist_percentile(&mpc_stat->warmup.latency, 99)
+               / (double)1000000);
+    }
+
+    printf("Phase (secs)          50%%         90%%         99%%       99.9%%"
+           "         max" CRLF);
+    mpc_stat_print_phase("Resolve", &mpc_stat->resolve);
+    mpc_stat_print_phase("Connect", &mpc_stat->connect);
+    mpc_stat_print_phase("First byte", &mpc_stat->first_byte);
+    mpc_stat_print_phase("Transfer", &mpc_stat->transfer);
+    printf(CRLF);
+
+    printf("Status codes:" CRLF);
+    for (i = 1; i < MPC_STAT_NSTATUS; i++) {
+        if (mpc_stat->status[i] != 0) {
+            printf("  %-34d %12u" CRLF, i, mpc_stat->status[i]);
+        }
+    }
+
+    if (mpc_stat->status[0] != 0) {
+        printf("  %-34s %12u" CRLF, "Other", mpc_stat->status[0]);
+    }
+
+    printf(CRLF);
+
+    if (mpc_stat->failed != 0) {
+        printf("Failures:" CRLF);
+        for (i = 0; i < MPC_STAT_NERRORS; i++) {
+            if (mpc_stat->errors[i] != 0) {
+                printf("  %-34s %12u" CRLF,
+                       mpc_stat_error_names[i], mpc_stat->errors[i]);
+            }
+        }
+
+        printf(CRLF);
+    }
+
+    if (mpc_stat->hosts->nelem > 1) {
+        mpc_stat_print_table(mpc_stat->hosts, "Busiest hosts:",
+                             mpc_stat_cmp_count, 0);
+    }
+
+    if (mpc_stat->urls->nelem > 1) {
+        mpc_stat_print_table(mpc_stat->urls, "Slowest urls (by 99%):",
+                             mpc_stat_cmp_slowest, 0);
+        mpc_stat_print_table(mpc_stat->urls, "Most failing urls:",
+                             mpc_stat_cmp_failed, 1);
+    }
+}
+
+
+int
+mpc_stat_get_format(char *format)
+{
+    if (strcasecmp(format, "text") == 0) {
+        return MPC_STAT_FORMAT_TEXT;
+    }
+
+    if (strcasecmp(format, "csv") == 0) {
+        return MPC_STAT_FORMAT_CSV;
+    }
+
+    if (strcasecmp(format, "json") == 0) {
+        return MPC_STAT_FORMAT_JSON;
+    }
+
+    return MPC_ERROR;
+}
+
+
+static void
+mpc_stat_out(mpc_stat_out_t *out, const char *fmt, ...)
+{
+    int      n;
+    va_list  args;
+
+    for ( ;; ) {
+        va_start(args, fmt);
+        n = vsnprintf(out->buf + out->len, sizeof(out->buf) - out->len,
+                      fmt, args);
+        va_end(args);
+
+        if (n < 0) {
+            out->err = 1;
+            return;
+        }
+
+        if ((size_t) n < sizeof(out->buf) - out->len) {
+            out->len += n;
+            return;
+        }
+
+        if (out->len == 0) {
+            /* longer than the whole buffer, truncated */
+            out->len = sizeof(out->buf) - 1;
+            return;
+        }
+
+        mpc_stat_out_flush(out);
+    }
+}
+
+
+static int
+mpc_stat_out_flush(mpc_stat_out_t *out)
+{
+    if (out->len != 0 && !out->err) {
+        if (write(out->fd, out->buf, out->len) < 0) {
+            mpc_log_err(errno, "write to fd:%d failed", out->fd);
+            out->err = 1;
+        }
+    }
+
+    out->len = 0;
+
+    return out->err ? MPC_ERROR : MPC_OK;
+}
+
+
+static void
+mpc_stat_out_json_str(mpc_stat_out_t *out, uint8_t *p, size_t len)
+{
+    uint8_t  *last = p + len;
+
+    mpc_stat_out(out, "\"");
+
+    while (p < last) {
+        if (*p == '"' || *p == '\\') {
+            mpc_stat_out(out, "\\%c", *p);
+
+        } else if (*p < 0x20) {
+            mpc_stat_out(out, "\\u%04x", *p);
+
+        } else {
+            mpc_stat_out(out, "%c", *p);
+        }
+
+        p++;
+    }
+
+    mpc_stat_out(out, "\"");
+}
+
+
+/*
+ * A histogram is written with every bucket used as [lowest, highest, count]
+ * in microseconds, so that any percentile can be recomputed later the same
+ * way mpc_stat_hist_percentile() does.
+ */
+static void
+mpc_stat_out_json_hist(mpc_stat_out_t *out, mpc_stat_hist_t *hist)
+{
+    uint32_t  i;
+    char     *sep;
+
+    mpc_stat_out(out, "{\"count\":%llu,\"min\":%llu,\"max\":%llu,\"sum\":%llu,"
+                      "\"buckets\":[",
+                 (unsigned long long) hist->count,
+                 (unsigned long long) (hist->count ? hist->min : 0),
+                 (unsigned long long) hist->max,
+                 (unsigned long long) hist->sum);
+
+    sep = "";
+
+    for (i = 0; i < MPC_STAT_HIST_NBUCKETS; i++) {
+        if (hist->buckets[i] == 0) {
+            continue;
+        }
+
+        mpc_stat_out(out, "%s[%llu,%llu,%llu]", sep,
+                     (unsigned long long)
+                     (i == 0 ? 0 : mpc_stat_hist_value(i - 1) + 1),
+                     (unsigned long long) mpc_stat_hist_value(i),
+                     (unsigned long long) hist->buckets[i]);
+        sep = ",";
+    }
+
+    mpc_stat_out(out, "]}");
+}
+
+
+static void
+mpc_stat_out_json_table(mpc_stat_out_t *out, mpc_stat_table_t *table)
+{
+    uint32_t           i;
+    char              *sep;
+    mpc_stat_entry_t  *entry;
+
+    mpc_stat_out(out, "[");
+
+    sep = "";
+
+    for (i = 0; i <= MPC_STAT_TABLE_SIZE; i++) {
+        entry = (i == MPC_STAT_TABLE_SIZE) ? &table->other : table->slots[i];
+
+        if (entry == NULL || entry->ok + entry->failed == 0) {
+            continue;
+        }
+
+        mpc_stat_out(out, "%s{\"name\":", sep);
+        mpc_stat_out_json_str(out, entry->name.data, entry->name.len);
+        mpc_stat_out(out, ",\"ok\":%u,\"failed\":%u,\"bytes\":%llu,"
+                          "\"latency\":",
+                     entry->ok, entry->failed,
+                     (unsigned long long) entry->bytes);
+        mpc_stat_out_json_hist(out, &entry->latency);
+        mpc_stat_out(out, "}");
+        sep = ",";
+    }
+
+    mpc_stat_out(out, "]");
+}
+
+
+static void
+mpc_stat_get_date(char *date, size_t size)
+{
+    struct tm   keepsake;
+    struct tm  *tmp;
+    time_t      now;
+
+    now = time(NULL);
+    tmp = (struct tm *)localtime_r(&now, &keepsake);
+
+    setlocale(LC_TIME, "C");
+    strftime(date, size, "%Y-%m-%d %H:%M:%S", tmp);
+}
+
+
+int
+mpc_stat_result_create(const char *file, int format)
+{
+    int    fd;
+    char  *head;
+
+    switch (format) {
+    case MPC_STAT_FORMAT_CSV:
+        head = "mark,time,transactions,elapsed,bytes,response_time,"
+               "transaction_rate,throughput,concurrency,ok,failed,"
+               "p50,p90,p99,p99.9,p99.99,longest,"
+               "resolve,refused,addrnotavail,timeout,reset,closed,"
+               "protocol,status,other,request_bytes,header_bytes,body_bytes\n";
+        break;
+
+    case MPC_STAT_FORMAT_JSON:
+        /* one object per line */
+        head = NULL;
+        break;
+
+    default:
+        head = "        Date & Time,     Trans,  Elap Time,  Data Trans,  "
+         "Resp Time,  Trans Rate,  Throughput,  Concurrent,      OKAY,    Failed,"
+         "       P50,       P90,       P99,     P99.9,    P99.99,   Longest,"
+         "   Resolve,   Refused,AddrNAvail,   Timeout,     Reset,    Closed,"
+         "  Protocol,    Status,     Other,   Sent MB, Header MB,   Body MB\n";
+        break;
+    }
+
+    if (access(file, F_OK) == 0) {
+        if ((fd = open(file, O_WRONLY|O_APPEND, 0644)) < 0) {
+            mpc_log_err(errno, "open result file \"%s\" failed", file);
+            return MPC_ERROR;
+        }
+
+        return fd;
+    }
+
+    if ((fd = open(file, O_CREAT|O_WRONLY|O_APPEND, 0644)) < 0) {
+        mpc_log_err(errno, "open result file \"%s\" failed", file);
+        return MPC_ERROR;
+    }
+
+    if (head != NULL && write(fd, head, strlen(head)) < 0) {
+        mpc_log_err(errno, "write head to fd:%d failed", fd);
+        close(fd);
+        return MPC_ERROR;
+    }
+
+    return fd;
+}
+
+
+static void
+mpc_stat_result_text(mpc_stat_out_t *out, mpc_stat_t *mpc_stat, char *mark,
+    char *date)
+{
+    if (mark != NULL) {
+        mpc_stat_out(out, "**** %s ****\n", mark);
+    }
+
+    mpc_stat_out(out,
+             "%19.19s,%10d,%11.2f,%12u,%11.6f,%12.2f,%12.2f,%12.2f,%10u,%10u,"
+             "%10.6f,%10.6f,%10.6f,%10.6f,%10.6f,%10.6f,"
+             "%10u,%10u,%10u,%10u,%10u,%10u,%10u,%10u,%10u,"
+             "%10.2f,%10.2f,%10.2f\n",
+             date, 
+             mpc_stat_get_transactions(mpc_stat),
+             mpc_stat_get_elapsed(mpc_stat),
+             (uint32_t)mpc_stat_get_data_transfered(mpc_stat),
+             mpc_stat_get_response_time(mpc_stat),
+             mpc_stat_get_transaction_rate(mpc_stat),
+             mpc_stat_get_throughput(mpc_stat),
+             mpc_stat_get_concurrency(mpc_stat),
+             mpc_stat_get_ok(mpc_stat),
+             mpc_stat_get_failed(mpc_stat),
+             mpc_stat_get_percentile(mpc_stat, 50),
+             mpc_stat_get_percentile(mpc_stat, 90),
+             mpc_stat_get_percentile(mpc_stat, 99),
+             mpc_stat_get_percentile(mpc_stat, 99.9),
+             mpc_stat_get_percentile(mpc_stat, 99.99),
+             mpc_stat_get_percentile(mpc_stat, 100),
+             mpc_stat->errors[MPC_STAT_ERR_RESOLVE],
+             mpc_stat->errors[MPC_STAT_ERR_REFUSED],
+             mpc_stat->errors[MPC_STAT_ERR_ADDRNOTAVAIL],
+             mpc_stat->errors[MPC_STAT_ERR_TIMEDOUT],
+             mpc_stat->errors[MPC_STAT_ERR_RESET],
+             mpc_stat->errors[MPC_STAT_ERR_CLOSED],
+             mpc_stat->errors[MPC_STAT_ERR_PROTOCOL],
+             mpc_stat->errors[MPC_STAT_ERR_STATUS],
+             mpc_stat->errors[MPC_STAT_ERR_OTHER],
+             mpc_stat->request_bytes / (double)(1024 * 1024),
+             mpc_stat->header_bytes / (double)(1024 * 1024),
+             mpc_stat->body_bytes / (double)(1024 * 1024));
+}
+
+
+static void
+mpc_stat_result_csv(mpc_stat_out_t *out, mpc_stat_t *mpc_stat, char *mark,
+    char *date)
+{
+    uint8_t  *p;
+
+    /* the mark is a column of its own, quoted as RFC 4180 wants */
+    mpc_stat_out(out, "\"");
+    for (p = (uint8_t *) mark; p != NULL && *p != '\0'; p++) {
+        if (*p == '"') {
+            mpc_stat_out(out, "\"");
+        }
+
+        mpc_stat_out(out, "%c", *p);
+    }
+
+    mpc_stat_out(out,
+             "\",%s,%u,%.6f,%llu,%.6f,%.2f,%.6f,%.2f,%u,%u,"
+             "%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%u,%u,%u,%u,%u,%u,%u,%u,%u,"
+             "%llu,%llu,%llu\n",
+             date,
+             mpc_stat_get_transactions(mpc_stat),
+             mpc_stat_get_elapsed(mpc_stat),
+             (unsigned long long) mpc_stat->bytes,
+             mpc_stat_get_response_time(mpc_stat),
+             mpc_stat_get_transaction_rate(mpc_stat),
+             mpc_stat_get_throughput(mpc_stat),
+             mpc_stat_get_concurrency(mpc_stat),
+             mpc_stat_get_ok(mpc_stat),
+             mpc_stat_get_failed(mpc_stat),
+             mpc_stat_get_percentile(mpc_stat, 50),
+             mpc_stat_get_percentile(mpc_stat, 90),
+             mpc_stat_get_percentile(mpc_stat, 99),
+             mpc_stat_get_percentile(mpc_stat, 99.9),
+             mpc_stat_get_percentile(mpc_stat, 99.99),
+             mpc_stat_get_percentile(mpc_stat, 100),
+             mpc_stat->errors[MPC_STAT_ERR_RESOLVE],
+             mpc_stat->errors[MPC_STAT_ERR_REFUSED],
+             mpc_stat->errors[MPC_STAT_ERR_ADDRNOTAVAIL],
+             mpc_stat->errors[MPC_STAT_ERR_TIMEDOUT],
+             mpc_stat->errors[MPC_STAT_ERR_RESET],
+             mpc_stat->errors[MPC_STAT_ERR_CLOSED],
+             mpc_stat->errors[MPC_STAT_ERR_PROTOCOL],
+             mpc_stat->errors[MPC_STAT_ERR_STATUS],
+             mpc_stat->errors[MPC_STAT_ERR_OTHER],
+             (unsigned long long) mpc_stat->request_bytes,
+             (unsigned long long) mpc_stat->header_bytes,
+             (unsigned long long) mpc_stat->body_bytes);
+}
+
+
+/* seconds, as the sweep prints them */
+static void
+mpc_stat_out_json_sweep(mpc_stat_out_t *out, mpc_sweep_t *sweep)
+{
+    uint32_t           i;
+    mpc_sweep_step_t  *step;
+
+    mpc_stat_out(out, ",\"sweep\":{\"step_time\":%llu,\"target\":",
+                 (unsigned long long) sweep->step_time);
+
+    if (sweep->has_target) {
+        mpc_stat_out_json_str(out, (uint8_t *) sweep->target.text,
+                              strlen(sweep->target.text));
+
+    } else {
+        mpc_stat_out(out, "null");
+    }
+
+    mpc_stat_out(out, ",\"steps\":[");
+
+    for (i = 0; i < sweep->steps->nelem; i++) {
+        step = mpc_array_get(sweep->steps, i);
+
+        mpc_stat_out(out, "%s{\"concurrency\":%llu,\"transaction_rate\":%.2f,"
+                          "\"throughput\":%.6f,\"p50\":%.6f,\"p99\":%.6f,"
+                          "\"error_rate\":%.4f,\"met\":%s}",
+                     i ? "," : "", (unsigned long long) step->concurrency,
+                     step->rate, step->throughput, step->p50, step->p99,
+                     step->error_rate,
+                     sweep->has_target ? (step->met ? "true" : "false")
+                                       : "null");
+    }
+
+    if (sweep->best == -1) {
+        mpc_stat_out(out, "],\"best\":null}");
+        return;
+    }
+
+    step = mpc_array_get(sweep->steps, sweep->best);
+
+    mpc_stat_out(out, "],\"best\":%llu}",
+                 (unsigned long long) step->concurrency);
+}
+
+
+static void
+mpc_stat_result_json(mpc_stat_out_t *out, mpc_instance_t *ins, char *date,
+    int snapshot)
+{
+    int              i;
+    char            *sep;
+    mpc_stat_slo_t  *slo;
+    mpc_stat_t      *mpc_stat = ins->stat;
+
+    mpc_stat_out(out, "{\"mark\":");
+    mpc_stat_out_json_str(out, ins->result_mark.data, ins->result_mark.len);
+
+    if (snapshot) {
+        mpc_stat_out(out, ",\"snapshot\":true");
+    }
+
+    mpc_stat_out(out, ",\"time\":\"%s\",\"unit\":\"us\",\"parameters\":{"
+                      "\"url_file\":", date);
+    mpc_stat_out_json_str(out, ins->url_file.data, ins->url_file.len);
+    mpc_stat_out(out, ",\"concurrency\":%llu,\"run_time\":%llu,"
+                      "\"http_method\":\"%s\",\"follow_location\":%s,"
+                      "\"replay\":%s,\"warmup\":%llu,"
+                      "\"warmup_requests\":%llu,\"success_codes\":",
+                 (unsigned long long) ins->concurrency,
+                 (unsigned long long) ins->run_time,
+                 ins->http_method == MPC_HTTP_METHOD_HEAD ? "HEAD" : "GET",
+                 ins->follow_location == 1 ? "true" : "false",
+                 ins->replay == 1 ? "true" : "false",
+                 (unsigned long long) ins->warmup,
+                 (unsigned long long) ins->warmup_requests);
+    mpc_stat_out_json_str(out, ins->success_codes.data,
+                          ins->success_codes.len);
+
+    mpc_stat_out(out, "},\"transactions\":%u,\"ok\":%u,\"failed\":%u,"
+                      "\"elapsed\":%llu,"
+                      "\"bytes\":%llu,\"request_bytes\":%llu,"
+                      "\"header_bytes\":%llu,\"body_bytes\":%llu,"
+                      "\"connections\":%u,\"reused\":%u,\"time_wait\":%d,"
+                      "\"fastopen\":%u,\"syn_data\":%u,"
+                      "\"total_time\":%llu,"
+                      "\"shortest\":%llu,\"longest\":%llu,"
+                      "\"transaction_rate\":%.2f,\"concurrency\":%.2f,"
+                      "\"percentiles\":{\"50\":%llu,\"90\":%llu,\"99\":%llu,"
+                      "\"99.9\":%llu,\"99.99\":%llu,\"100\":%llu},"
+                      "\"status\":{",
+                 mpc_stat_get_transactions(mpc_stat),
+                 mpc_stat->ok, mpc_stat->failed,
+                 (unsigned long long) (mpc_stat->stop - mpc_stat->start),
+                 (unsigned long long) mpc_stat->bytes,
+                 (unsigned long long) mpc_stat->request_bytes,
+                 (unsigned long long) mpc_stat->header_bytes,
+                 (unsigned long long) mpc_stat->body_bytes,
+                 mpc_stat->connections, mpc_stat->reused,
+                 mpc_stat->time_wait,
+                 mpc_stat->fastopen, mpc_stat->syn_data,
+                 (unsigned long long) mpc_stat->total_time,
+                 (unsigned long long)
+                 (mpc_stat->latency.count ? mpc_stat->shortest : 0),
+                 (unsigned long long) mpc_stat->longest,
+                 mpc_stat_get_transaction_rate(mpc_stat),
+                 mpc_stat_get_concurrency(mpc_stat),
+                 (unsigned long long)
+                 mpc_stat_hist_percentile(&mpc_stat->latency, 50),
+                 (unsigned long long)
+                 mpc_stat_hist_percentile(&mpc_stat->latency, 90),
+                 (unsigned long long)
+                 mpc_stat_hist_percentile(&mpc_stat->latency, 99),
+                 (unsigned long long)
+                 mpc_stat_hist_percentile(&mpc_stat->latency, 99.9),
+                 (unsigned long long)
+                 mpc_stat_hist_percentile(&mpc_stat->latency, 99.99),
+                 (unsigned long long)
+                 mpc_stat_hist_percentile(&mpc_stat->latency, 100));
+
+    sep = "";
+
+    for (i = 0; i < MPC_STAT_NSTATUS; i++) {
+        if (mpc_stat->status[i] == 0) {
+            continue;
+        }
+
+        /* codes out of range are counted in the first slot */
+        if (i == 0) {
+            mpc_stat_out(out, "%s\"other\":%u", sep, mpc_stat->status[i]);
+
+        } else {
+            mpc_stat_out(out, "%s\"%d\":%u", sep, i, mpc_stat->status[i]);
+        }
+
+        sep = ",";
+    }
+
+    mpc_stat_out(out, "},\"errors\":{");
+
+    for (i = 0; i < MPC_STAT_NERRORS; i++) {
+        mpc_stat_out(out, "%s\"%s\":%u", i ? "," : "",
+                     mpc_stat_error_keys[i], mpc_stat->errors[i]);
+    }
+
+    mpc_stat_out(out, "}");
+
+    if (ins->slos != NULL) {
+        mpc_stat_out(out, ",\"objectives\":[");
+
+        for (i = 0; i < (int) ins->slos->nelem; i++) {
+            slo = mpc_array_get(ins->slos, i);
+
+            mpc_stat_out(out, "%s{\"objective\":", i ? "," : "");
+            mpc_stat_out_json_str(out, (uint8_t *) slo->text,
+                                  strlen(slo->text));
+            mpc_stat_out(out, ",\"met\":%s,\"windows\":%u,\"missed\":%u,"
+                              "\"worst\":%.3f}",
+                         slo->missed > ins->slo_tolerance ? "false" : "true",
+                         slo->windows, slo->missed, slo->worst);
+        }
+
+        mpc_stat_out(out, "]");
+    }
+
+    if (ins->sweep != NULL) {
+        mpc_stat_out_json_sweep(out, ins->sweep);
+    }
+
+    if (mpc_stat->warmup.stop != 0) {
+        mpc_stat_out(out, ",\"warmup\":{\"elapsed\":%llu,\"ok\":%u,"
+                          "\"failed\":%u,\"bytes\":%llu,\"latency\":",
+                     (unsigned long long)
+                     (mpc_stat->warmup.stop - mpc_stat->warmup.start),
+                     mpc_stat->warmup.ok, mpc_stat->warmup.failed,
+                     (unsigned long long) mpc_stat->warmup.bytes);
+        mpc_stat_out_json_hist(out, &mpc_stat->warmup.latency);
+        mpc_stat_out(out, "}");
+    }
+
+    mpc_stat_out(out, ",\"histograms\":{\"latency\":");
+    mpc_stat_out_json_hist(out, &mpc_stat->latency);
+    mpc_stat_out(out, ",\"resolve\":");
+    mpc_stat_out_json_hist(out, &mpc_stat->resolve);
+    mpc_stat_out(out, ",\"connect\":");
+    mpc_stat_out_json_hist(out, &mpc_stat->connect);
+    mpc_stat_out(out, ",\"first_byte\":");
+    mpc_stat_out_json_hist(out, &mpc_stat->first_byte);
+    mpc_stat_out(out, ",\"transfer\":");
+    mpc_stat_out_json_hist(out, &mpc_stat->transfer);
+    mpc_stat_out(out, "},\"hosts\":");
+    mpc_stat_out_json_table(out, mpc_stat->hosts);
+    mpc_stat_out(out, ",\"urls\":");
+    mpc_stat_out_json_table(out, mpc_stat->urls);
+    mpc_stat_out(out, "}\n");
+}
+
+
+int
+mpc_stat_result_record(int fd, mpc_instance_t *ins, int snapshot)
+{
+    char             date[65];
+    char             buf[128];
+    char            *mark;
+    mpc_stat_out_t   out;
+
+    if (ins->stat->ok + ins->stat->failed == 0) {
+        return MPC_OK;
+    }
+
+    out.fd = fd;
+    out.err = 0;
+    out.len = 0;
+
+    mark = (char *) ins->result_mark.data;
+
+    if (snapshot) {
+        /* the run is not over, mpc-compare leaves such records out */
+        snprintf(buf, sizeof(buf), "%.*s%s" MPC_STAT_SNAPSHOT_MARK,
+                 (int) MPC_MIN(ins->result_mark.len, 64), mark,
+                 ins->result_mark.len ? " " : "");
+        mark = buf;
+    }
+
+    mpc_stat_get_date(date, sizeof(date));
+
+    switch (ins->output_format) {
+    case MPC_STAT_FORMAT_CSV:
+        mpc_stat_result_csv(&out, ins->stat, mark, date);
+        break;
+
+    case MPC_STAT_FORMAT_JSON:
+        mpc_stat_result_json(&out, ins, date, snapshot);
+        break;
+
+    default:
+        mpc_stat_result_text(&out, ins->stat, mark, date);
+        break;
+    }
+
+    if (mpc_stat_out_flush(&out) != MPC_OK) {
+        close(fd);
+        return MPC_ERROR;
+    }
+
+    return MPC_OK;
+}
+
+
+int
+mpc_stat_series_create(const char *file, int format)
+{
+    int           fd;
+    char         *head;
+    struct stat   st;
+
+    switch (format) {
+    case MPC_STAT_FORMAT_CSV:
+        head = "time,elapsed,transactions,transaction_rate,throughput,"
+               "failed,p50,p90,p99,p99.9,max\n";
+        break;
+
+    case MPC_STAT_FORMAT_JSON:
+        head = NULL;
+        break;
+
+    default:
+        head = "        Date & Time,   Elapsed,     Trans,  Trans Rate,  "
+         "Throughput,    Failed,       P50,       P90,       P99,     P99.9,"
+         "       Max\n";
+        break;
+    }
+
+    if (file == NULL) {
+        fd = STDOUT_FILENO;
+
+    } else if ((fd = open(file, O_CREAT|O_WRONLY|O_APPEND, 0644)) < 0) {
+        mpc_log_err(errno, "open series file \"%s\" failed", file);
+        return MPC_ERROR;
+
+    } else if (fstat(fd, &st) == 0 && st.st_size != 0) {
+        /* appended to the rows of an earlier run, the head is there */
+        return fd;
+    }
+
+    if (head != NULL && write(fd, head, strlen(head)) < 0) {
+        mpc_log_err(errno, "write head to fd:%d failed", fd);
+        if (fd != STDOUT_FILENO) {
+            close(fd);
+        }
+        return MPC_ERROR;
+    }
+
+    return fd;
+}
+
+
+int
+mpc_stat_series_record(int fd, int format, mpc_stat_window_t *delta,
+    uint64_t start)
+{
+    char             date[65];
+    double           secs;
+    mpc_stat_out_t   out;
+
+    secs = (delta->stop - delta->start) / (double)1000000;
+    if (secs <= 0) {
+        return MPC_OK;
+    }
+
+    out.fd = fd;
+    out.err = 0;
+    out.len = 0;
+
+    mpc_stat_get_date(date, sizeof(date));
+
+    switch (format) {
+    case MPC_STAT_FORMAT_JSON:
+        mpc_stat_out(&out, "{\"time\":\"%s\",\"start\":%llu,\"stop\":%llu,"
+                           "\"ok\":%u,\"failed\":%u,\"bytes\":%llu,"
+                           "\"latency\":",
+                     date,
+                     (unsigned long long) (delta->start - start),
+                     (unsigned long long) (delta->stop - start),
+                     delta->ok, delta->failed,
+                     (unsigned long long) delta->bytes);
+        mpc_stat_out_json_hist(&out, &delta->latency);
+        mpc_stat_out(&out, "}\n");
+        break;
+
+    default:
+        mpc_stat_out(&out,
+             format == MPC_STAT_FORMAT_CSV
+             ? "%s,%.2f,%u,%.2f,%.6f,%u,%.6f,%.6f,%.6f,%.6f,%.6f\n"
+             : "%19.19s,%10.2f,%10u,%12.2f,%12.2f,%10u,"
+               "%10.6f,%10.6f,%10.6f,%10.6f,%10.6f\n",
+             date,
+             (delta->stop - start) / (double)1000000,
+             delta->ok + delta->failed,
+             (delta->ok + delta->failed) / secs,
+             delta->bytes / (double)(1024 * 1024) / secs,
+             delta->failed,
+             mpc_stat_hist_percentile(&delta->latency, 50) / (double)1000000,
+             mpc_stat_hist_percentile(&delta->latency, 90) / (double)1000000,
+             mpc_stat_hist_percentile(&delta->latency, 99) / (double)1000000,
+             mpc_stat_hist_percentile(&delta->latency, 99.9)
+             / (double)1000000,
+             delta->latency.max / (double)1000000);
+        break;
+    }
+
+    return mpc_stat_out_flush(&out);
 }
 
 
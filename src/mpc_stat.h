@@ -35,25 +35,177 @@
 #define MPC_STAT_MAGIC      0x53544154      /* "STAT" */
 
 
+/*
+ * Latency histogram buckets are log-linear: values below
+ * 2 << MPC_STAT_HIST_SUB_BITS get a bucket each, above that every power
+ * of two is split into 1 << MPC_STAT_HIST_SUB_BITS buckets, so the
+ * relative error stays under 1 / (1 << MPC_STAT_HIST_SUB_BITS). Values
+ * of 1 << MPC_STAT_HIST_MAX_BITS and beyond fall into the last bucket.
+ */
+#define MPC_STAT_HIST_SUB_BITS      6
+#define MPC_STAT_HIST_MAX_BITS      36
+#define MPC_STAT_HIST_NBUCKETS                                              \
+    ((MPC_STAT_HIST_MAX_BITS - MPC_STAT_HIST_SUB_BITS + 1)                  \
+     << MPC_STAT_HIST_SUB_BITS)
+
+
+#define MPC_STAT_NSTATUS        600   /* status codes 0 - 599, 0 for others */
+
+
+/* ends the mark of a record written on SIGUSR1 before the run is over */
+#define MPC_STAT_SNAPSHOT_MARK  "(snapshot)"
+
+
+/* why a transaction failed */
+#define MPC_STAT_ERR_RESOLVE        0   /* dns lookup failed */
+#define MPC_STAT_ERR_REFUSED        1   /* ECONNREFUSED */
+#define MPC_STAT_ERR_ADDRNOTAVAIL   2   /* EADDRNOTAVAIL, local ports used up */
+#define MPC_STAT_ERR_TIMEDOUT       3   /* ETIMEDOUT */
+#define MPC_STAT_ERR_RESET          4   /* ECONNRESET, EPIPE */
+#define MPC_STAT_ERR_CLOSED         5   /* server closed prematurely */
+#define MPC_STAT_ERR_PROTOCOL       6   /* malformed response */
+#define MPC_STAT_ERR_STATUS         7   /* status code not in success codes */
+#define MPC_STAT_ERR_OTHER          8
+#define MPC_STAT_NERRORS            9
+
+
+#define MPC_STAT_FORMAT_TEXT    0
+#define MPC_STAT_FORMAT_CSV     1
+#define MPC_STAT_FORMAT_JSON    2
+
+#define MPC_STAT_OUT_BUF_SIZE   16384
+
+
+/* service level objectives, checked on one second windows */
+#define MPC_STAT_SLO_LATENCY        0   /* pNN < 50ms */
+#define MPC_STAT_SLO_ERROR_RATE     1   /* error_rate < 0.1% */
+#define MPC_STAT_SLO_RPS            2   /* rps > 20000 */
+
+#define MPC_STAT_SLO_LT             0
+#define MPC_STAT_SLO_LE             1
+#define MPC_STAT_SLO_GT             2
+#define MPC_STAT_SLO_GE             3
+
+#define MPC_STAT_SLO_WINDOW         1000000   /* microseconds */
+#define MPC_STAT_SLO_TEXT_SIZE      64
+
+
+#define MPC_STAT_TABLE_MAX      256   /* entries per table, others are merged */
+#define MPC_STAT_TABLE_SIZE     512   /* hash slots, power of two */
+#define MPC_STAT_TOP_N          10
+
+
+typedef struct {
+    uint64_t    count;
+    uint64_t    min;
+    uint64_t    max;
+    uint64_t    sum;
+    uint64_t    buckets[MPC_STAT_HIST_NBUCKETS];
+} mpc_stat_hist_t;
+
+
+/* statistics of the requests to one url or one host */
+struct mpc_stat_entry_s {
+    mpc_str_t          name;
+    uint32_t           failed;
+    uint32_t           ok;
+    uint64_t           bytes;
+    mpc_stat_hist_t    latency;
+};
+
+
+typedef struct {
+    uint32_t           nelem;
+    mpc_stat_entry_t  *slots[MPC_STAT_TABLE_SIZE];
+    mpc_stat_entry_t   other;
+} mpc_stat_table_t;
+
+
+/*
+ * A window holds either a copy of the cumulative counters taken when it
+ * was opened, or the difference between two such copies once closed.
+ */
+typedef struct {
+    uint64_t           start;        /* monotonic microseconds */
+    uint64_t           stop;         /* monotonic microseconds */
+    uint32_t           failed;
+    uint32_t           ok;
+    uint64_t           bytes;
+    mpc_stat_hist_t    latency;
+} mpc_stat_window_t;
+
+
+typedef struct {
+    char               text[MPC_STAT_SLO_TEXT_SIZE];
+    int                metric;
+    int                op;
+    double             percentile;   /* latency objectives only */
+    double             target;       /* microseconds, percent or per second */
+    uint32_t           windows;      /* windows checked */
+    uint32_t           missed;       /* windows the objective was missed in */
+    double             worst;
+} mpc_stat_slo_t;
+
+
 struct mpc_stat_s {
 #ifdef WITH_DEBUG
-    uint32_t    magic;
+    uint32_t           magic;
 #endif
-    uint32_t    failed;
-    uint32_t    ok;
-    uint64_t    shortest;
-    uint64_t    longest;
-    uint64_t    bytes;
-    uint64_t    total_time;
-    uint64_t    start;
-    uint64_t    stop;
+    uint32_t           failed;
+    uint32_t           ok;
+    uint64_t           shortest;     /* microseconds */
+    uint64_t           longest;      /* microseconds */
+    uint64_t           bytes;        /* received */
+    uint64_t           request_bytes;
+    uint64_t           header_bytes;
+    uint64_t           body_bytes;
+    uint32_t           connections;  /* opened */
+    uint32_t           reused;       /* transactions on kept connections */
+    uint32_t           fastopen;     /* connections opened with TFO */
+    uint32_t           syn_data;     /* of them, data in SYN accepted */
+    int                time_wait;    /* sockets left at the end, -1 unknown */
+    uint64_t           total_time;   /* microseconds */
+    uint64_t           start;        /* monotonic microseconds */
+    uint64_t           stop;         /* monotonic microseconds */
+    mpc_stat_hist_t    latency;
+    mpc_stat_hist_t    resolve;
+    mpc_stat_hist_t    connect;
+    mpc_stat_hist_t    first_byte;
+    mpc_stat_hist_t    transfer;
+    uint32_t           status[MPC_STAT_NSTATUS];
+    uint32_t           errors[MPC_STAT_NERRORS];
+    mpc_stat_table_t  *urls;
+    mpc_stat_table_t  *hosts;
+    mpc_stat_window_t  warmup;       /* what was excluded, kept by reset */
 };
 
 
+
+
+/* buffered writer of the result and series files */
+typedef struct {
+    int                fd;
+    int                err;
+    size_t             len;
+    char               buf[MPC_STAT_OUT_BUF_SIZE];
+} mpc_stat_out_t;
+
+
 #define mpc_stat_inc_bytes(s, b)        (s)->bytes += (b)
+#define mpc_stat_inc_request_bytes(s, b) (s)->request_bytes += (b)
+#define mpc_stat_inc_header_bytes(s, b) (s)->header_bytes += (b)
+#define mpc_stat_inc_body_bytes(s, b)   (s)->body_bytes += (b)
+#define mpc_stat_inc_connections(s)     (s)->connections++
+#define mpc_stat_inc_reused(s)          (s)->reused++
+#define mpc_stat_inc_fastopen(s)        (s)->fastopen++
+#define mpc_stat_inc_syn_data(s)        (s)->syn_data++
 #define mpc_stat_inc_ok(s)              (s)->ok++
 #define mpc_stat_inc_failed(s)          (s)->failed++
 #define mpc_stat_inc_total_time(s, e)   (s)->total_time += (e)
+#define mpc_stat_inc_error(s, e)        (s)->errors[e]++
+#define mpc_stat_inc_status(s, c)                                           \
+    (s)->status[((c) > 0 && (c) < MPC_STAT_NSTATUS) ? (c) : 0]++
+#define mpc_stat_entry_inc_failed(e)    (e)->failed++
 #define mpc_stat_get_ok(s)              (s)->ok
 #define mpc_stat_get_failed(s)          (s)->failed
 
@@ -61,12 +213,34 @@ struct mpc_stat_s {
 mpc_stat_t *mpc_stat_create(void);
 int mpc_stat_init(mpc_stat_t *mpc_stat);
 void mpc_stat_destroy(mpc_stat_t *mpc_stat);
+void mpc_stat_reset(mpc_stat_t *mpc_stat, uint64_t now);
+void mpc_stat_warmup_done(mpc_stat_t *mpc_stat, uint64_t now);
 void mpc_stat_set_longest(mpc_stat_t *mpc_stat, uint64_t longest);
 void mpc_stat_set_shortest(mpc_stat_t *mpc_stat, uint64_t shortest);
+void mpc_stat_hist_reset(mpc_stat_hist_t *hist);
+void mpc_stat_hist_record(mpc_stat_hist_t *hist, uint64_t value);
+void mpc_stat_hist_merge(mpc_stat_hist_t *dst, mpc_stat_hist_t *src);
+uint64_t mpc_stat_hist_percentile(mpc_stat_hist_t *hist, double percentile);
+void mpc_stat_window_open(mpc_stat_window_t *window, mpc_stat_t *mpc_stat,
+    uint64_t now);
+void mpc_stat_window_close(mpc_stat_window_t *window, mpc_stat_t *mpc_stat,
+    uint64_t now, mpc_stat_window_t *delta);
+mpc_stat_entry_t *mpc_stat_table_get(mpc_stat_table_t *table, uint8_t *name,
+    size_t len);
+void mpc_stat_entry_record(mpc_stat_entry_t *entry, int ok, uint64_t bytes,
+    uint64_t elapsed);
+int mpc_stat_error_type(int err);
 void mpc_stat_print(mpc_stat_t *mpc_stat);
-int mpc_stat_result_record(int fd, mpc_stat_t *mpc_stat, char *mark);
-int mpc_stat_result_create(const char *file);
+int mpc_stat_get_format(char *format);
+int mpc_stat_result_record(int fd, mpc_instance_t *ins, int snapshot);
+int mpc_stat_result_create(const char *file, int format);
 int mpc_stat_result_close(int fd);
+int mpc_stat_series_create(const char *file, int format);
+int mpc_stat_slo_parse(mpc_stat_slo_t *slo, char *text);
+int mpc_stat_slo_check(mpc_stat_slo_t *slo, mpc_stat_window_t *delta);
+void mpc_stat_slo_print(mpc_array_t *slos, uint64_t tolerance);
+int mpc_stat_series_record(int fd, int format, mpc_stat_window_t *delta,
+    uint64_t start);
 
 
 #endif /* __MPC_STAT_H_INCLUDED__ */
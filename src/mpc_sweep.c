@@ -0,0 +1,349 @@
+/*
+ * mpc -- A Multiple Protocol Client.
+ * Copyright (c) 2013, FengGu <flygoast@gmail.com>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+#include <mpc_core.h>
+
+
+static uint64_t mpc_sweep_next(mpc_sweep_t *sweep);
+static void mpc_sweep_record(mpc_instance_t *ins, mpc_stat_window_t *delta);
+static void mpc_sweep_print_step(mpc_sweep_step_t *step, int has_target);
+
+
+/*
+ * The spec is either a schedule "50,100,200,400", stepped in order, or
+ * a range "10-1000" that is binary-searched.
+ */
+mpc_sweep_t *
+mpc_sweep_create(uint8_t *spec, size_t len)
+{
+    uint8_t      *p, *last, *dash;
+    int64_t       n, m;
+    uint64_t     *c;
+    mpc_sweep_t  *sweep;
+
+    sweep = mpc_calloc(1, sizeof(mpc_sweep_t));
+    if (sweep == NULL) {
+        return NULL;
+    }
+
+    sweep->best = -1;
+    sweep->step_time = MPC_SWEEP_DEFAULT_STEP;
+
+    sweep->steps = mpc_array_create(16, sizeof(mpc_sweep_step_t));
+    if (sweep->steps == NULL) {
+        goto failed;
+    }
+
+    dash = mpc_strlchr(spec, spec + len, '-');
+
+    if (dash != NULL) {
+        n = mpc_atoi(spec, dash - spec);
+        m = mpc_atoi(dash + 1, spec + len - dash - 1);
+
+        if (n == MPC_ERROR || m == MPC_ERROR
+            || n < 1 || n > m || m > MPC_MAX_CONCURRENCY)
+        {
+            goto failed;
+        }
+
+        sweep->search = 1;
+        sweep->low = n;
+        sweep->high = m;
+        sweep->current = mpc_sweep_next(sweep);
+
+        return sweep;
+    }
+
+    sweep->schedule = mpc_array_create(8, sizeof(uint64_t));
+    if (sweep->schedule == NULL) {
+        goto failed;
+    }
+
+    for (p = spec, last = spec + len; p < last; p++) {
+        dash = mpc_strlchr(p, last, ',');
+        if (dash == NULL) {
+            dash = last;
+        }
+
+        n = mpc_atoi(p, dash - p);
+        if (n == MPC_ERROR || n < 1 || n > MPC_MAX_CONCURRENCY) {
+            goto failed;
+        }
+
+        c = mpc_array_push(sweep->schedule);
+        if (c == NULL) {
+            goto failed;
+        }
+
+        *c = n;
+        p = dash;
+    }
+
+    if (sweep->schedule->nelem == 0) {
+        goto failed;
+    }
+
+    sweep->current = mpc_sweep_next(sweep);
+
+    return sweep;
+
+failed:
+
+    mpc_sweep_destroy(sweep);
+
+    return NULL;
+}
+
+
+void
+mpc_sweep_destroy(mpc_sweep_t *sweep)
+{
+    if (sweep->schedule != NULL) {
+        mpc_array_destroy(sweep->schedule);
+    }
+
+    if (sweep->steps != NULL) {
+        mpc_array_destroy(sweep->steps);
+    }
+
+    mpc_free(sweep);
+}
+
+
+static uint64_t
+mpc_sweep_next(mpc_sweep_t *sweep)
+{
+    uint64_t  *c;
+
+    if (!sweep->search) {
+        if (sweep->next == sweep->schedule->nelem) {
+            return 0;
+        }
+
+        c = mpc_array_get(sweep->schedule, sweep->next++);
+
+        return *c;
+    }
+
+    /* close enough once the range left is within the precision */
+    if (sweep->high < sweep->low
+        || (sweep->steps->nelem != 0
+            && sweep->high - sweep->low < sweep->low / MPC_SWEEP_PRECISION))
+    {
+        return 0;
+    }
+
+    return sweep->low + (sweep->high - sweep->low) / 2;
+}
+
+
+/*
+ * Called on every cron tick once measuring started. Each step changes
+ * the concurrency mpc_http_create_missing_requests() keeps up, waits for
+ * the in-flight requests to follow, then measures the rest of the step.
+ * It returns MPC_DONE after the last step.
+ */
+int
+mpc_sweep_process(mpc_instance_t *ins, uint64_t now)
+{
+    uint64_t      step_time;
+    mpc_sweep_t  *sweep = ins->sweep;
+
+    step_time = sweep->step_time * 1000000;
+
+    if (sweep->current == 0) {
+        sweep->current = mpc_sweep_next(sweep);
+        if (sweep->current == 0) {
+            return MPC_DONE;
+        }
+
+        sweep->start = 0;
+    }
+
+    if (sweep->start == 0) {
+        if (sweep->steps->nelem == 0) {
+            printf("Concurrency   Trans rate  Throughput         P50"
+                   "         P99    Failed%s" CRLF,
+                   sweep->has_target ? "  Target" : "");
+        }
+
+        ins->concurrency = sweep->current;
+        sweep->start = now;
+        sweep->measuring = 0;
+
+        return MPC_OK;
+    }
+
+    if (!sweep->measuring) {
+        if (now >= sweep->start + step_time / MPC_SWEEP_SETTLE) {
+            mpc_stat_window_open(&sweep->window, ins->stat, now);
+            sweep->measuring = 1;
+        }
+
+        return MPC_OK;
+    }
+
+    if (now < sweep->start + step_time) {
+        return MPC_OK;
+    }
+
+    mpc_stat_window_close(&sweep->window, ins->stat, now, &sweep->delta);
+    mpc_sweep_record(ins, &sweep->delta);
+
+    sweep->current = 0;
+
+    return mpc_sweep_process(ins, now);
+}
+
+
+/* the statistics were reset, measure the step from now on */
+void
+mpc_sweep_reset(mpc_sweep_t *sweep, mpc_stat_t *mpc_stat, uint64_t now)
+{
+    if (sweep->measuring) {
+        mpc_stat_window_open(&sweep->window, mpc_stat, now);
+    }
+}
+
+
+static void
+mpc_sweep_record(mpc_instance_t *ins, mpc_stat_window_t *delta)
+{
+    double             secs;
+    uint32_t           total;
+    mpc_stat_slo_t     target;
+    mpc_sweep_step_t  *step, *best;
+    mpc_sweep_t       *sweep = ins->sweep;
+
+    step = mpc_array_push(sweep->steps);
+    if (step == NULL) {
+        mpc_log_err(errno, "oom when record sweep step");
+        return;
+    }
+
+    secs = (delta->stop - delta->start) / (double)1000000;
+    total = delta->ok + delta->failed;
+
+    step->concurrency = sweep->current;
+    step->rate = total / secs;
+    step->throughput = delta->bytes / (double)(1024 * 1024) / secs;
+    step->p50 = mpc_stat_hist_percentile(&delta->latency, 50)
+                / (double)1000000;
+    step->p99 = mpc_stat_hist_percentile(&delta->latency, 99)
+                / (double)1000000;
+    step->error_rate = total ? delta->failed * 100 / (double) total : 0;
+
+    /* a step without a completed request meets no target */
+    target = sweep->target;
+    step->met = sweep->has_target
+                && mpc_stat_slo_check(&target, delta) == MPC_OK
+                && target.windows != 0;
+
+    mpc_sweep_print_step(step, sweep->has_target);
+    fflush(stdout);
+
+    if (sweep->search) {
+        if (step->met) {
+            sweep->low = step->concurrency + 1;
+
+        } else {
+            sweep->high = step->concurrency - 1;
+        }
+    }
+
+    /*
+     * with a target the best step is the highest concurrency meeting it,
+     * without one the highest transaction rate
+     */
+    if (sweep->has_target ? !step->met : total == 0) {
+        return;
+    }
+
+    if (sweep->best != -1) {
+        best = mpc_array_get(sweep->steps, sweep->best);
+
+        if (sweep->has_target ? best->concurrency > step->concurrency
+                              : best->rate >= step->rate)
+        {
+            return;
+        }
+    }
+
+    sweep->best = sweep->steps->nelem - 1;
+}
+
+
+static void
+mpc_sweep_print_step(mpc_sweep_step_t *step, int has_target)
+{
+    printf("%11llu %12.2f %11.2f %11.6f %11.6f %8.2f%%%s" CRLF,
+           (unsigned long long) step->concurrency, step->rate,
+           step->throughput, step->p50, step->p99, step->error_rate,
+           has_target ? (step->met ? "  met" : "  missed") : "");
+}
+
+
+void
+mpc_sweep_print(mpc_sweep_t *sweep)
+{
+    uint32_t           i;
+    mpc_sweep_step_t  *step;
+
+    printf(CRLF "Sweep (%llu secs a step, the first 1/%d skipped):" CRLF
+           "Concurrency   Trans rate  Throughput         P50"
+           "         P99    Failed%s" CRLF,
+           (unsigned long long) sweep->step_time, MPC_SWEEP_SETTLE,
+           sweep->has_target ? "  Target" : "");
+
+    for (i = 0; i < sweep->steps->nelem; i++) {
+        mpc_sweep_print_step(mpc_array_get(sweep->steps, i),
+                             sweep->has_target);
+    }
+
+    if (sweep->best == -1) {
+        printf(CRLF "No step %s" CRLF,
+               sweep->has_target ? "met the target" : "completed");
+        return;
+    }
+
+    step = mpc_array_get(sweep->steps, sweep->best);
+
+    if (sweep->has_target) {
+        printf(CRLF "Highest concurrency meeting \"%s\": %llu, "
+               "%.2f trans/sec" CRLF,
+               sweep->target.text, (unsigned long long) step->concurrency,
+               step->rate);
+
+    } else {
+        printf(CRLF "Highest transaction rate: %.2f trans/sec "
+               "at concurrency %llu" CRLF,
+               step->rate, (unsigned long long) step->concurrency);
+    }
+}
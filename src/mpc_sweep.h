@@ -0,0 +1,82 @@
+/*
+ * mpc -- A Multiple Protocol Client.
+ * Copyright (c) 2013, FengGu <flygoast@gmail.com>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __MPC_SWEEP_H_INCLUDED__
+#define __MPC_SWEEP_H_INCLUDED__
+
+
+#define MPC_SWEEP_DEFAULT_STEP  10      /* seconds */
+#define MPC_SWEEP_SETTLE        5       /* the first 1/5 of a step is skipped */
+#define MPC_SWEEP_PRECISION     20      /* a search ends within 1/20 */
+
+
+typedef struct {
+    uint64_t           concurrency;
+    double             rate;         /* transactions per second */
+    double             throughput;   /* MB per second */
+    double             p50;          /* seconds */
+    double             p99;          /* seconds */
+    double             error_rate;   /* percent */
+    unsigned           met:1;
+} mpc_sweep_step_t;
+
+
+/*
+ * A sweep steps the concurrency over a schedule such as "50,100,200",
+ * or binary-searches a range such as "10-1000" for the highest
+ * concurrency that meets the target.
+ */
+struct mpc_sweep_s {
+    mpc_array_t       *schedule;     /* uint64_t concurrencies */
+    mpc_array_t       *steps;        /* mpc_sweep_step_t, as measured */
+    uint64_t           low;
+    uint64_t           high;
+    uint64_t           step_time;    /* seconds */
+    uint64_t           current;      /* concurrency of the running step */
+    uint64_t           start;        /* monotonic microseconds */
+    uint32_t           next;         /* next index in the schedule */
+    int                best;         /* index in steps, -1 for none */
+    mpc_stat_slo_t     target;
+    mpc_stat_window_t  window;
+    mpc_stat_window_t  delta;
+    unsigned           search:1;
+    unsigned           has_target:1;
+    unsigned           measuring:1;
+};
+
+
+mpc_sweep_t *mpc_sweep_create(uint8_t *spec, size_t len);
+void mpc_sweep_destroy(mpc_sweep_t *sweep);
+int mpc_sweep_process(mpc_instance_t *ins, uint64_t now);
+void mpc_sweep_reset(mpc_sweep_t *sweep, mpc_stat_t *mpc_stat, uint64_t now);
+void mpc_sweep_print(mpc_sweep_t *sweep);
+
+
+#endif /* __MPC_SWEEP_H_INCLUDED__ */
@@ -0,0 +1,166 @@
+/*
+ * mpc -- A Multiple Protocol Client.
+ * Copyright (c) 2013, FengGu <flygoast@gmail.com>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+
+#include <mpc_core.h>
+
+
+/*
+ * A hashed timing wheel: a timer goes in the slot of the tick it expires
+ * at, so that adding and deleting one is O(1) however many are pending.
+ * A timer more than a turn of the wheel away stays in its slot until the
+ * turn it expires in.
+ */
+
+
+static int mpc_timer_process(mpc_event_loop_t *el, int64_t id, void *data);
+
+
+static mpc_timer_hdr_t  mpc_timer_wheel[MPC_TIMER_SLOTS];
+static mpc_timer_hdr_t  mpc_timer_expired;
+static uint64_t         mpc_timer_tick;      /* the last tick processed */
+
+
+int
+mpc_timer_init(mpc_event_loop_t *el)
+{
+    uint32_t  i;
+
+    for (i = 0; i < MPC_TIMER_SLOTS; i++) {
+        TAILQ_INIT(&mpc_timer_wheel[i]);
+    }
+
+    TAILQ_INIT(&mpc_timer_expired);
+
+    mpc_timer_tick = mpc_current_usec / 1000 / MPC_TIMER_TICK;
+
+    if (mpc_create_time_event(el, MPC_TIMER_TICK, mpc_timer_process, NULL,
+                              NULL)
+        == MPC_ERROR)
+    {
+        return MPC_ERROR;
+    }
+
+    return MPC_OK;
+}
+
+
+/* the timers belong to their owners, the slots are just forgotten */
+void
+mpc_timer_deinit(void)
+{
+    uint32_t  i;
+
+    for (i = 0; i < MPC_TIMER_SLOTS; i++) {
+        TAILQ_INIT(&mpc_timer_wheel[i]);
+    }
+
+    TAILQ_INIT(&mpc_timer_expired);
+}
+
+
+void
+mpc_timer_add(mpc_timer_t *timer, uint64_t ms)
+{
+    uint64_t  expire;
+
+    if (timer->hdr != NULL) {
+        mpc_timer_del(timer);
+    }
+
+    /* rounded up, a timer never fires early */
+    expire = (mpc_current_usec / 1000 + ms + MPC_TIMER_TICK - 1)
+             / MPC_TIMER_TICK;
+
+    if (expire <= mpc_timer_tick) {
+        expire = mpc_timer_tick + 1;
+    }
+
+    timer->expire = expire;
+    timer->hdr = &mpc_timer_wheel[expire & (MPC_TIMER_SLOTS - 1)];
+
+    TAILQ_INSERT_TAIL(timer->hdr, timer, next);
+}
+
+
+void
+mpc_timer_del(mpc_timer_t *timer)
+{
+    if (timer->hdr == NULL) {
+        return;
+    }
+
+    TAILQ_REMOVE(timer->hdr, timer, next);
+    timer->hdr = NULL;
+}
+
+
+static int
+mpc_timer_process(mpc_event_loop_t *el, int64_t id, void *data)
+{
+    uint64_t          now;
+    mpc_timer_t      *timer, *next;
+    mpc_timer_hdr_t  *slot;
+
+    now = mpc_current_usec / 1000 / MPC_TIMER_TICK;
+
+    while (mpc_timer_tick < now) {
+        mpc_timer_tick++;
+
+        slot = &mpc_timer_wheel[mpc_timer_tick & (MPC_TIMER_SLOTS - 1)];
+
+        for (timer = TAILQ_FIRST(slot); timer != NULL; timer = next) {
+            next = TAILQ_NEXT(timer, next);
+
+            if (timer->expire > mpc_timer_tick) {
+                continue;
+            }
+
+            TAILQ_REMOVE(slot, timer, next);
+            timer->hdr = &mpc_timer_expired;
+            TAILQ_INSERT_TAIL(&mpc_timer_expired, timer, next);
+        }
+
+        /*
+         * a handler may delete other expired timers, they are taken
+         * one by one
+         */
+        while (!TAILQ_EMPTY(&mpc_timer_expired)) {
+            timer = TAILQ_FIRST(&mpc_timer_expired);
+
+            TAILQ_REMOVE(&mpc_timer_expired, timer, next);
+            timer->hdr = NULL;
+
+            timer->handler(timer);
+        }
+    }
+
+    return MPC_TIMER_TICK;
+}
@@ -0,0 +1,67 @@
+/*
+ * mpc -- A Multiple Protocol Client.
+ * Copyright (c) 2013, FengGu <flygoast@gmail.com>
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+
+#ifndef __MPC_TIMER_H_INCLUDED__
+#define __MPC_TIMER_H_INCLUDED__
+
+
+#define MPC_TIMER_SLOTS         1024  /* power of two */
+#define MPC_TIMER_TICK          10    /* milliseconds */
+
+
+typedef struct mpc_timer_s mpc_timer_t;
+typedef struct mpc_timer_hdr_s mpc_timer_hdr_t;
+
+typedef void (*mpc_timer_handler_pt)(mpc_timer_t *timer);
+
+
+struct mpc_timer_s {
+    TAILQ_ENTRY(mpc_timer_s)    next;
+    mpc_timer_hdr_t            *hdr;      /* the slot it is in, or NULL */
+    uint64_t                    expire;   /* in ticks */
+    mpc_timer_handler_pt        handler;
+    void                       *data;
+};
+
+
+TAILQ_HEAD(mpc_timer_hdr_s, mpc_timer_s);
+
+
+int mpc_timer_init(mpc_event_loop_t *el);
+void mpc_timer_deinit(void);
+void mpc_timer_add(mpc_timer_t *timer, uint64_t ms);
+void mpc_timer_del(mpc_timer_t *timer);
+
+
+#define mpc_timer_set(timer)    ((timer)->hdr != NULL)
+
+
+#endif /* __MPC_TIMER_H_INCLUDED__ */
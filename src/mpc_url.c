@@ -144,6 +144,9 @@ mpc_url_get(void)
     SET_MAGIC(mpc_url, MPC_URL_MAGIC);
 done:
     STAILQ_NEXT(mpc_url, next) = NULL;
+    mpc_url->url_stat = NULL;
+    mpc_url->host_stat = NULL;
+    mpc_url->pool = NULL;
 
     pthread_mutex_unlock(&mutex_free);
 
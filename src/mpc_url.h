@@ -52,6 +52,9 @@ struct mpc_url_s {
     int                         port;
     uint8_t                    *buf;
     uint32_t                    buf_size;
+    mpc_stat_entry_t           *url_stat;
+    mpc_stat_entry_t           *host_stat;
+    mpc_pool_t                 *pool;
     unsigned                    no_resolve:1;
     unsigned                    no_put:1;
 };
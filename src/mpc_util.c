@@ -31,6 +31,13 @@
 #include <mpc_core.h>
 
 
+/*
+ * The monotonic time in microseconds cached by the event loop once per
+ * iteration, read it instead of calling clock_gettime() on hot paths.
+ */
+uint64_t  mpc_current_usec;
+
+
 static struct timespec
 dtotimespec(double sec)
 {
@@ -85,14 +92,12 @@ mpc_nanosleep(double seconds)
 }
 
 
+/* Split the cached monotonic time, used to schedule time events. */
 void
 mpc_get_time(int64_t *seconds, int64_t *milliseconds)
 {
-    struct timeval tv;
-
-    gettimeofday(&tv, NULL);
-    *seconds = tv.tv_sec;
-    *milliseconds = tv.tv_usec / 1000;
+    *seconds = mpc_current_usec / 1000000;
+    *milliseconds = (mpc_current_usec / 1000) % 1000;
 }
 
 
@@ -141,3 +146,28 @@ mpc_time_us(void)
     ust += tv.tv_usec;
     return ust;
 }
+
+
+/*
+ * Microseconds from an unspecified starting point, not affected by
+ * discontinuous jumps of the system time, only for measuring intervals.
+ */
+uint64_t
+mpc_time_monotonic_us(void)
+{
+    struct timespec  ts;
+    uint64_t         ust;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ust = ((uint64_t)ts.tv_sec) * 1000000;
+    ust += ts.tv_nsec / 1000;
+    return ust;
+}
+
+
+uint64_t
+mpc_time_update(void)
+{
+    mpc_current_usec = mpc_time_monotonic_us();
+    return mpc_current_usec;
+}
@@ -65,11 +65,16 @@
 #define BILLION         (1000 * 1000 * 1000)
 
 
+extern uint64_t  mpc_current_usec;
+
+
 int mpc_nanosleep(double seconds);
 void mpc_add_milliseconds_to_now(int64_t ms_delta, int64_t *sec, int64_t *ms);
 void mpc_get_time(int64_t *seconds, int64_t *milliseconds);
 uint64_t mpc_time_ms(void);
 uint64_t mpc_time_us(void);
+uint64_t mpc_time_monotonic_us(void);
+uint64_t mpc_time_update(void);
 
 
 #endif /* __MPC_UTIL_H_INCLUDED__ */